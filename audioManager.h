@@ -0,0 +1,108 @@
+#ifndef AUDIO_MANAGER_H
+#define AUDIO_MANAGER_H
+
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include "jobSystem.h"
+#include "logger.h"
+
+// Music tracks are registered once and opened on the job system, so the
+// game thread never touches the disk or a decoder. Play() is cheap and
+// idempotent: asking for the track that is already playing (or already
+// queued) does nothing, otherwise the current track fades out and the new
+// one fades in from Update() once it has finished loading. SDL_mixer only
+// has one music stream, so the "crossfade" is a fade-out followed by a
+// fade-in rather than an overlap.
+class AudioManager {
+public:
+    explicit AudioManager(JobSystem& j) : jobs(j), current(-1), pending(-1), pendingFadeMs(0) {}
+    ~AudioManager() { Shutdown(); }
+
+    // Returns the id to pass to Play().
+    int Preload(const std::string& path) {
+        Track* track = new Track();
+        track->path = path;
+        track->load = jobs.Submit([track] {
+            track->music = Mix_LoadMUS(track->path.c_str());
+            if (!track->music) {
+                LOG_ERROR("Failed to load music {}: {}", track->path, Mix_GetError());
+            }
+            track->ready = true;
+        });
+        tracks.emplace_back(track);
+        return static_cast<int>(tracks.size()) - 1;
+    }
+
+    void Play(int id, int fadeMs = 500) {
+        if (id < 0 || id >= static_cast<int>(tracks.size()) || id == pending) {
+            return;
+        }
+        if (id == current && pending < 0) {
+            return;
+        }
+        pending = id;
+        pendingFadeMs = fadeMs;
+        if (current >= 0 && Mix_PlayingMusic()) {
+            Mix_FadeOutMusic(fadeMs);
+        }
+    }
+
+    void Stop(int fadeMs = 500) {
+        pending = -1;
+        current = -1;
+        Mix_FadeOutMusic(fadeMs);
+    }
+
+    // Once per frame on the game thread.
+    void Update() {
+        if (pending < 0 || Mix_PlayingMusic()) {
+            return;
+        }
+        Track& next = *tracks[pending];
+        if (!next.ready) {
+            return;
+        }
+        if (next.music) {
+            Mix_FadeInMusic(next.music, -1, pendingFadeMs);
+        }
+        current = pending;
+        pending = -1;
+    }
+
+    // Stops playback and frees every track; call before Mix_CloseAudio().
+    void Shutdown() {
+        if (tracks.empty()) {
+            return;
+        }
+        Mix_HaltMusic();
+        for (auto& track : tracks) {
+            jobs.Wait(track->load);
+            if (track->music) {
+                Mix_FreeMusic(track->music);
+            }
+        }
+        tracks.clear();
+        current = pending = -1;
+    }
+
+private:
+    struct Track {
+        std::string path;
+        Mix_Music* music;
+        std::atomic<bool> ready;
+        JobHandle load;
+
+        Track() : music(nullptr), ready(false) {}
+    };
+
+    JobSystem& jobs;
+    std::vector<std::unique_ptr<Track>> tracks;
+    int current;
+    int pending;
+    int pendingFadeMs;
+};
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef AUTOTILE_H
+#define AUTOTILE_H
+
+#include <cstdint>
+#include <vector>
+#include "tileGrid.h"
+
+// Autotiling for ground. Soil (1) and grass (2) are one terrain: which of
+// them a cell looks like, and which of its edges get a border, follows
+// from which of its four neighbours are ground too. Each ground cell keeps
+// a 4-bit mask of its ground neighbours and AUTOTILE_LUT turns the mask
+// into the variant to draw; the tile values themselves are never changed.
+// Cells off the map count as ground, so the map border draws no edges.
+//
+// Build() computes every mask once when a level is loaded. After that an
+// edit only affects the masks of the edited cell and its neighbours, so
+// Update() recomputes the 3x3 block around it and reports the cells whose
+// variant changed, which is all that needs redrawing.
+
+const int AUTOTILE_NORTH = 1;
+const int AUTOTILE_EAST = 2;
+const int AUTOTILE_SOUTH = 4;
+const int AUTOTILE_WEST = 8;
+const int AUTOTILE_VARIANTS = 16;
+const uint8_t AUTOTILE_NONE = 0xFF;
+
+inline bool IsAutotiled(int type) { return type == 1 || type == 2; }
+
+// Variant per neighbour mask. Variants are numbered by the edges they
+// border, which is the mask inverted: a cell with ground on every side is
+// plain soil (0), one with nothing above it gets a grass top, and so on.
+// Kept as a table so the artwork can share variants between masks.
+const uint8_t AUTOTILE_LUT[AUTOTILE_VARIANTS] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+};
+
+class Autotiler {
+public:
+    Autotiler() : width(0), height(0) {}
+
+    void Build(const TileGrid& grid) {
+        width = grid.Width();
+        height = grid.Height();
+        variants.assign(static_cast<size_t>(width) * height, AUTOTILE_NONE);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                variants[static_cast<size_t>(y) * width + x] = Compute(grid, x, y);
+            }
+        }
+    }
+
+    // Call after the tile at (x, y) changed. changed(cx, cy) is called for
+    // every cell in the 3x3 block whose variant is now different, and for
+    // (x, y) itself, whose type changed.
+    template <typename Changed>
+    void Update(const TileGrid& grid, int x, int y, Changed changed) {
+        for (int cy = y - 1; cy <= y + 1; ++cy) {
+            for (int cx = x - 1; cx <= x + 1; ++cx) {
+                if (cx < 0 || cy < 0 || cx >= width || cy >= height) {
+                    continue;
+                }
+                uint8_t& variant = variants[static_cast<size_t>(cy) * width + cx];
+                uint8_t updated = Compute(grid, cx, cy);
+                if (updated != variant || (cx == x && cy == y)) {
+                    variant = updated;
+                    changed(cx, cy);
+                }
+            }
+        }
+    }
+
+    // AUTOTILE_NONE for cells that are not ground.
+    int Variant(int x, int y) const { return variants[static_cast<size_t>(y) * width + x]; }
+
+private:
+    int width, height;
+    std::vector<uint8_t> variants;
+
+    static bool Ground(const TileGrid& grid, int x, int y) {
+        return !grid.Contains(x, y) || IsAutotiled(grid.Get(x, y));
+    }
+
+    static uint8_t Compute(const TileGrid& grid, int x, int y) {
+        if (!IsAutotiled(grid.Get(x, y))) {
+            return AUTOTILE_NONE;
+        }
+        int mask = (Ground(grid, x, y - 1) ? AUTOTILE_NORTH : 0) | (Ground(grid, x + 1, y) ? AUTOTILE_EAST : 0) |
+                   (Ground(grid, x, y + 1) ? AUTOTILE_SOUTH : 0) | (Ground(grid, x - 1, y) ? AUTOTILE_WEST : 0);
+        return AUTOTILE_LUT[mask];
+    }
+};
+
+#endif
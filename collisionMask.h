@@ -0,0 +1,55 @@
+#ifndef COLLISION_MASK_H
+#define COLLISION_MASK_H
+
+#include <cstdint>
+#include <vector>
+#include "tileGrid.h"
+
+// Soil and grass are the only tiles the player cannot pass through.
+inline bool IsSolidTile(int type) { return type == 1 || type == 2; }
+
+// One bit per tile of the collision layer, set where the tile is solid.
+// Collision queries read only this, never the tile values themselves, and
+// a tile edit updates a single bit.
+class CollisionMask {
+public:
+    CollisionMask() : width(0), height(0), stride(0) {}
+
+    void Build(const TileGrid& collision) {
+        width = collision.Width();
+        height = collision.Height();
+        stride = (width + 63) / 64;
+        bits.assign(static_cast<size_t>(stride) * height, 0);
+        for (int y = 0; y < height; ++y) {
+            const std::vector<int>& row = collision.Row(y);
+            for (int x = 0; x < width; ++x) {
+                if (IsSolidTile(row[x])) {
+                    bits[Word(x, y)] |= Bit(x);
+                }
+            }
+        }
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+    bool Contains(int x, int y) const { return x >= 0 && x < width && y >= 0 && y < height; }
+
+    bool Solid(int x, int y) const { return (bits[Word(x, y)] & Bit(x)) != 0; }
+
+    void Set(int x, int y, bool solid) {
+        if (solid) {
+            bits[Word(x, y)] |= Bit(x);
+        } else {
+            bits[Word(x, y)] &= ~Bit(x);
+        }
+    }
+
+private:
+    int width, height, stride;
+    std::vector<uint64_t> bits;
+
+    size_t Word(int x, int y) const { return static_cast<size_t>(y) * stride + (x >> 6); }
+    static uint64_t Bit(int x) { return uint64_t(1) << (x & 63); }
+};
+
+#endif
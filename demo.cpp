@@ -4,11 +4,27 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <memory>
 #include <vector>
+#include "audioManager.h"
+#include "jobSystem.h"
+#include "sceneManager.h"
+#include "sfxSynth.h"
+#include "sfxSystem.h"
+#include "uiWidgets.h"
 
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 const int TILE_SIZE = 32;
+const int PLAY_FPS_CAP = 120;
+const int MENU_FPS_CAP = 30;
+const int IDLE_TIMEOUT_MS = 500;
+
+enum DemoScene {
+    SCENE_MENU,
+    SCENE_PLAYING,
+    SCENE_PAUSED
+};
 
 class Player {
 private:
@@ -30,7 +46,6 @@ public:
     void Run();
     void Shutdown();
     void Update();
-    void RenderPauseMenu();
     int checkCollision(int choice = 0);
 
 private:
@@ -47,15 +62,32 @@ private:
 
     std::vector<std::vector<int>> levelData;
 
-    // SDL_mixer variables
-    Mix_Music* backgroundMusic;
+    // Music is preloaded off the game thread and switched with fades
+    JobSystem jobs;
+    AudioManager audio;
+    int mainTrack;
+    int fallTrack;
     bool musicPlaying;
+    SfxSystem sfx;
+    int jumpSound;
+    int landSound;
 
     // Start menu variables
     bool showPlayButton;
     bool enterPressed;
     bool gameStarted;
 
+    SceneManager scenes;
+
+    // Menus are built once in Initialize and redrawn only when they change
+    TTF_Font* menuFont;
+    std::unique_ptr<UiScreen> startMenu;
+    std::unique_ptr<UiScreen> pauseMenu;
+
+    DemoScene CurrentScene() const;
+    void BuildMenus();
+    void StartGame();
+    void NewGame();
     void LoadLevelConfiguration(const std::string& configFile);
     void RenderScene();
     void handleInput();
@@ -70,12 +102,17 @@ GameEngine::GameEngine()
       jump(false),
       isJumping(false),
       velocityY(0),
-      backgroundMusic(nullptr),
+      audio(jobs),
+      mainTrack(-1),
+      fallTrack(-1),
       musicPlaying(false),
+      jumpSound(-1),
+      landSound(-1),
       showPlayButton(true),
       enterPressed(false),
       gameStarted(false),
-      isPaused(false) {} // Corrected here
+      isPaused(false),
+      menuFont(nullptr) {} // Corrected here
 
 GameEngine::~GameEngine() {
     Shutdown();
@@ -114,32 +151,61 @@ void GameEngine::Initialize(const char* title, int width, int height) {
 
     LoadLevelConfiguration("level_config.txt");
 
-    // Load music
-    backgroundMusic = Mix_LoadMUS("C:\\Users\\ASUS\\Downloads\\Dafacutt.mp3");
-    if (!backgroundMusic) {
-        std::cerr << "Failed to load music: " << Mix_GetError() << std::endl;
-        // Handle loading error
+    menuFont = TTF_OpenFont("PressStart2P-Regular.ttf", 24);
+    if (!menuFont) {
+        std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
     }
+    BuildMenus();
+
+    sfx.Open(16);
+    jumpSound = sfx.Load("jump.wav", SynthJump(), 1, 50, 4);
+    landSound = sfx.Load("land.wav", SynthLand(), 0, 50, 4);
+
+    // Load music in the background
+    mainTrack = audio.Preload("C:\\Users\\ASUS\\Downloads\\Dafacutt.mp3");
+    fallTrack = audio.Preload("C:\\Users\\ASUS\\Downloads\\Dafa.mp3");
 
     isRunning = true;
 }
 
 void GameEngine::Run() {
     std::cout << "Run";
+    scenes.SetPolicy(SCENE_MENU, {true, MENU_FPS_CAP, IDLE_TIMEOUT_MS});
+    scenes.SetPolicy(SCENE_PLAYING, {false, PLAY_FPS_CAP, 0});
+    scenes.SetPolicy(SCENE_PAUSED, {true, MENU_FPS_CAP, IDLE_TIMEOUT_MS});
     while (isRunning) {
+        scenes.WaitForNextFrame();
         handleInput();
-        if (!showPlayButton) {
+        scenes.SetScene(CurrentScene());
+        if (scenes.Scene() == SCENE_PLAYING) {
             Update();
         }
-        RenderScene();
+        audio.Update();
+        sfx.Update();
+        if (scenes.NeedsRender()) {
+            RenderScene();
+            scenes.FrameRendered();
+        }
+    }
+}
+
+DemoScene GameEngine::CurrentScene() const {
+    if (showPlayButton && !gameStarted) {
+        return SCENE_MENU;
     }
+    return isPaused ? SCENE_PAUSED : SCENE_PLAYING;
 }
 
 void GameEngine::Shutdown() {
     std::cout << "Shutdown";
-    if (backgroundMusic) {
-        Mix_FreeMusic(backgroundMusic);
+    startMenu.reset();
+    pauseMenu.reset();
+    if (menuFont) {
+        TTF_CloseFont(menuFont);
+        menuFont = nullptr;
     }
+    audio.Shutdown();
+    sfx.Shutdown();
 
     if (renderer) {
         SDL_DestroyRenderer(renderer);
@@ -225,6 +291,9 @@ void GameEngine::Update() {
         // Adjust position and stop falling if there's a collision
         py.y = (py.y / TILE_SIZE) * TILE_SIZE;
         velocityY = 0;
+        if (isJumping) {
+            sfx.Trigger(landSound);
+        }
         isJumping = false;
     }
 
@@ -232,10 +301,11 @@ void GameEngine::Update() {
     if (jump && !isJumping) {
         isJumping = true;
         velocityY -= py.JUMP_VELOCITY;
+        sfx.Trigger(jumpSound);
 
         // Play background music when jumping
         if (!musicPlaying) {
-            Mix_PlayMusic(backgroundMusic, -1);  // -1 for loop indefinitely
+            audio.Play(mainTrack, 0);  // loops until switched
             musicPlaying = true;
         }
     }
@@ -251,14 +321,9 @@ void GameEngine::Update() {
 
     // Check if the player is out of bounds at the bottom
     if (py.y + TILE_SIZE > SCREEN_HEIGHT) {
-        // Change the background music when out of bounds at the bottom
-        Mix_HaltMusic();  // Stop the current music
-        backgroundMusic = Mix_LoadMUS("C:\\Users\\ASUS\\Downloads\\Dafa.mp3");
-        if (!backgroundMusic) {
-            std::cerr << "Failed to load another music: " << Mix_GetError() << std::endl;
-            // Handle loading error
-        }
-        Mix_PlayMusic(backgroundMusic, -1);  // Play the new music
+        // Change the background music when out of bounds at the bottom;
+        // repeated calls while still out of bounds are no-ops
+        audio.Play(fallTrack);
     }
 }
 
@@ -294,96 +359,48 @@ void GameEngine::LoadLevelConfiguration(const std::string& configFile) {
     }
 }
 
-// ... (existing code)
-
-// ... (existing code)
-
-void GameEngine::RenderPauseMenu() {
-    // Render pause menu in the center
-    SDL_Rect menuRect = {SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2};
-    SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);  // Gray color for the menu background
-    SDL_RenderFillRect(renderer, &menuRect);
-
-    // Render "Resume" text on the menu
-    TTF_Font* resumeFont = TTF_OpenFont("C:\\Users\\ASUS\\Downloads\\Press_Start_2P\\PressStart2P-Regular.ttf", 24);
-    if (!resumeFont) {
-        std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
-        // Handle loading error
-    } else {
-        SDL_Color resumeTextColor = {255, 255, 255, 255};  // White color
-        SDL_Surface* resumeTextSurface = TTF_RenderText_Solid(resumeFont, "Resume", resumeTextColor);
-        if (resumeTextSurface) {
-            SDL_Texture* resumeTextTexture = SDL_CreateTextureFromSurface(renderer, resumeTextSurface);
-            if (resumeTextTexture) {
-                SDL_Rect resumeTextRect = {SCREEN_WIDTH / 2 - 30, SCREEN_HEIGHT / 2 - 15, 60, 30};
-                SDL_RenderCopy(renderer, resumeTextTexture, nullptr, &resumeTextRect);
-
-                SDL_DestroyTexture(resumeTextTexture);
-            } else {
-                std::cerr << "Failed to create texture from surface: " << SDL_GetError() << std::endl;
-            }
-
-            SDL_FreeSurface(resumeTextSurface);
-        } else {
-            std::cerr << "Failed to render text surface: " << TTF_GetError() << std::endl;
-        }
-
-        TTF_CloseFont(resumeFont);
-    }
-
-    // Render "Start" text on the menu
-    TTF_Font* startFont = TTF_OpenFont("C:\\Users\\ASUS\\Downloads\\Press_Start_2P\\PressStart2P-Regular.ttf", 24);
-    if (!startFont) {
-        std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
-        // Handle loading error
-    } else {
-        SDL_Color startTextColor = {255, 255, 255, 255};  // White color
-        SDL_Surface* startTextSurface = TTF_RenderText_Solid(startFont, "Start New Game (S)", startTextColor);
-        if (startTextSurface) {
-            SDL_Texture* startTextTexture = SDL_CreateTextureFromSurface(renderer, startTextSurface);
-            if (startTextTexture) {
-                SDL_Rect startTextRect = {SCREEN_WIDTH / 2 - 90, SCREEN_HEIGHT / 2 + 45, 180, 30};
-                SDL_RenderCopy(renderer, startTextTexture, nullptr, &startTextRect);
-
-                SDL_DestroyTexture(startTextTexture);
-            } else {
-                std::cerr << "Failed to create texture from surface: " << SDL_GetError() << std::endl;
-            }
-
-            SDL_FreeSurface(startTextSurface);
-        } else {
-            std::cerr << "Failed to render text surface: " << TTF_GetError() << std::endl;
-        }
-
-        TTF_CloseFont(startFont);
-    }
-
-    // Render "Exit" text on the menu
-    TTF_Font* exitFont = TTF_OpenFont("C:\\Users\\ASUS\\Downloads\\Press_Start_2P\\PressStart2P-Regular.ttf", 24);
-    if (!exitFont) {
-        std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
-        // Handle loading error
-    } else {
-        SDL_Color exitTextColor = {255, 255, 255, 255};  // White color
-        SDL_Surface* exitTextSurface = TTF_RenderText_Solid(exitFont, "Exit (E)", exitTextColor);
-        if (exitTextSurface) {
-            SDL_Texture* exitTextTexture = SDL_CreateTextureFromSurface(renderer, exitTextSurface);
-            if (exitTextTexture) {
-                SDL_Rect exitTextRect = {SCREEN_WIDTH / 2 - 60, SCREEN_HEIGHT / 2 + 105, 120, 30};
-                SDL_RenderCopy(renderer, exitTextTexture, nullptr, &exitTextRect);
-
-                SDL_DestroyTexture(exitTextTexture);
-            } else {
-                std::cerr << "Failed to create texture from surface: " << SDL_GetError() << std::endl;
-            }
+void GameEngine::BuildMenus() {
+    const SDL_Color white = {255, 255, 255, 255};
+    const SDL_Color gray = {128, 128, 128, 255};
+
+    // Start menu: Enter activates the focused button, S starts, E and Esc exit.
+    startMenu.reset(new UiScreen(renderer, SCREEN_WIDTH, SCREEN_HEIGHT));
+    Button* play = startMenu->AddButton(startMenu->Root(), new Button(
+        {SCREEN_WIDTH / 2 - 50, SCREEN_HEIGHT / 2 - 25, 100, 50}, {0, 255, 0, 255}, SDLK_s, [this] { StartGame(); }));
+    play->SetLabel({SCREEN_WIDTH / 2 - 30, SCREEN_HEIGHT / 2 - 15, 60, 30}, menuFont, "Start", white);
+    Button* quit = startMenu->AddButton(startMenu->Root(), new Button(
+        {SCREEN_WIDTH / 2 - 50, SCREEN_HEIGHT / 2 + 30, 100, 50}, {255, 0, 0, 255}, SDLK_e, [this] { isRunning = false; }));
+    quit->SetLabel({SCREEN_WIDTH / 2 - 30, SCREEN_HEIGHT / 2 + 45, 60, 30}, menuFont, "Exit", white);
+    startMenu->SetCancel([this] { isRunning = false; });
+
+    // Pause menu: Esc resumes, S starts over, E exits.
+    pauseMenu.reset(new UiScreen(renderer, SCREEN_WIDTH, SCREEN_HEIGHT));
+    Panel* panel = pauseMenu->Root()->Add(new Panel({SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2}, gray));
+    Button* resume = pauseMenu->AddButton(panel, new Button(
+        {SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 20, 200, 40}, gray, SDLK_UNKNOWN, [this] { isPaused = false; }));
+    resume->SetLabel({SCREEN_WIDTH / 2 - 30, SCREEN_HEIGHT / 2 - 15, 60, 30}, menuFont, "Resume", white);
+    Button* restart = pauseMenu->AddButton(panel, new Button(
+        {SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 40, 200, 40}, gray, SDLK_s, [this] { NewGame(); }));
+    restart->SetLabel({SCREEN_WIDTH / 2 - 90, SCREEN_HEIGHT / 2 + 45, 180, 30}, menuFont, "Start New Game (S)", white);
+    Button* exitGame = pauseMenu->AddButton(panel, new Button(
+        {SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 + 100, 200, 40}, gray, SDLK_e, [this] { isRunning = false; }));
+    exitGame->SetLabel({SCREEN_WIDTH / 2 - 60, SCREEN_HEIGHT / 2 + 105, 120, 30}, menuFont, "Exit (E)", white);
+    pauseMenu->SetCancel([this] { isPaused = false; });
+}
 
-            SDL_FreeSurface(exitTextSurface);
-        } else {
-            std::cerr << "Failed to render text surface: " << TTF_GetError() << std::endl;
-        }
+void GameEngine::StartGame() {
+    showPlayButton = false;
+    gameStarted = true;
+}
 
-        TTF_CloseFont(exitFont);
-    }
+void GameEngine::NewGame() {
+    py = Player();
+    velocityY = 0;
+    isJumping = false;
+    left = right = jump = false;
+    isPaused = false;
+    LoadLevelConfiguration("level_config.txt");
+    StartGame();
 }
 
 void GameEngine::handleInput() {
@@ -391,7 +408,20 @@ void GameEngine::handleInput() {
     while (SDL_PollEvent(&event) != 0) {
         if (event.type == SDL_QUIT) {
             isRunning = false;
+        } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+            startMenu->Invalidate();
+            pauseMenu->Invalidate();
         } else if (event.type == SDL_KEYDOWN) {
+            // Menus get first pick of the keyboard while they are up
+            DemoScene scene = CurrentScene();
+            if (scene == SCENE_MENU) {
+                startMenu->HandleKey(event.key.keysym.sym);
+                continue;
+            }
+            if (scene == SCENE_PAUSED) {
+                pauseMenu->HandleKey(event.key.keysym.sym);
+                continue;
+            }
             switch (event.key.keysym.sym) {
                 case SDLK_SPACE:
                     jump = true;
@@ -404,36 +434,9 @@ void GameEngine::handleInput() {
                     right = true;
                     left = false; // Ensure that only one direction is active
                     break;
-                case SDLK_s:
-                    // Start a new game when 'S' key is pressed
-                    if (isPaused && showPlayButton && !gameStarted) {
-                        showPlayButton = false;
-                        gameStarted = true;  // Set gameStarted to true
-                    }
-                    break;
-                case SDLK_e:
-                    // Exit the application when 'E' key is pressed
-                    if (isPaused && !gameStarted) {
-                        isRunning = false;
-                    }
-                    break;
-                case SDLK_RETURN:
-                    if (!isPaused) {
-                        // Resume the game when Enter key is pressed (only if not paused)
-                        if (showPlayButton && !gameStarted) {
-                            showPlayButton = false;
-                            gameStarted = true;  // Set gameStarted to true
-                        }
-                    }
-                    break;
                 case SDLK_ESCAPE:
-                    if (!gameStarted) {
-                        // Exit the application when Esc key is pressed before starting
-                        isRunning = false;
-                    } else {
-                        // Toggle pause when Esc key is pressed during the game
-                        isPaused = !isPaused;
-                    }
+                    // Pause the game; the pause menu handles resuming
+                    isPaused = true;
                     break;
                 default:
                     break;
@@ -464,69 +467,7 @@ void GameEngine::RenderScene() {
     SDL_RenderClear(renderer);
 
     if (showPlayButton && !gameStarted) {
-        // Render play button in the center
-        SDL_Rect playButtonRect = {SCREEN_WIDTH / 2 - 50, SCREEN_HEIGHT / 2 - 25, 100, 50};
-        SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);  // Green color for the play button
-        SDL_RenderFillRect(renderer, &playButtonRect);
-
-        // Render "Start" text on the play button
-        TTF_Font* font = TTF_OpenFont("C:\\Users\\ASUS\\Downloads\\Press_Start_2P\\PressStart2P-Regular.ttf", 24);
-        if (!font) {
-            std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
-            // Handle loading error
-        } else {
-            SDL_Color textColor = {255, 255, 255, 255};  // White color
-            SDL_Surface* textSurface = TTF_RenderText_Solid(font, "Start", textColor);
-            if (textSurface) {
-                SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-                if (textTexture) {
-                    SDL_Rect textRect = {SCREEN_WIDTH / 2 - 30, SCREEN_HEIGHT / 2 - 15, 60, 30};
-                    SDL_RenderCopy(renderer, textTexture, nullptr, &textRect);
-
-                    SDL_DestroyTexture(textTexture);
-                } else {
-                    std::cerr << "Failed to create texture from surface: " << SDL_GetError() << std::endl;
-                }
-
-                SDL_FreeSurface(textSurface);
-            } else {
-                std::cerr << "Failed to render text surface: " << TTF_GetError() << std::endl;
-            }
-
-            TTF_CloseFont(font);
-        }
-
-        // Render exit button below the play button
-        SDL_Rect exitButtonRect = {SCREEN_WIDTH / 2 - 50, SCREEN_HEIGHT / 2 + 30, 100, 50};
-        SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);  // Red color for the exit button
-        SDL_RenderFillRect(renderer, &exitButtonRect);
-
-        // Render "Exit" text on the exit button
-        TTF_Font* exitFont = TTF_OpenFont("C:\\Users\\ASUS\\Downloads\\Press_Start_2P\\PressStart2P-Regular.ttf", 24);
-        if (!exitFont) {
-            std::cerr << "Failed to load font: " << TTF_GetError() << std::endl;
-            // Handle loading error
-        } else {
-            SDL_Color exitTextColor = {255, 255, 255, 255};  // White color
-            SDL_Surface* exitTextSurface = TTF_RenderText_Solid(exitFont, "Exit", exitTextColor);
-            if (exitTextSurface) {
-                SDL_Texture* exitTextTexture = SDL_CreateTextureFromSurface(renderer, exitTextSurface);
-                if (exitTextTexture) {
-                    SDL_Rect exitTextRect = {SCREEN_WIDTH / 2 - 30, SCREEN_HEIGHT / 2 + 45, 60, 30};
-                    SDL_RenderCopy(renderer, exitTextTexture, nullptr, &exitTextRect);
-
-                    SDL_DestroyTexture(exitTextTexture);
-                } else {
-                    std::cerr << "Failed to create texture from surface: " << SDL_GetError() << std::endl;
-                }
-
-                SDL_FreeSurface(exitTextSurface);
-            } else {
-                std::cerr << "Failed to render text surface: " << TTF_GetError() << std::endl;
-            }
-
-            TTF_CloseFont(exitFont);
-        }
+        startMenu->Render();
     } else {
                 // Render the game scene as before
         for (size_t y = 0; y < levelData.size(); ++y) {
@@ -556,10 +497,9 @@ void GameEngine::RenderScene() {
         SDL_RenderFillRect(renderer, &PlayerRect);
     }
     if (isPaused) {
-        RenderPauseMenu();
+        pauseMenu->Render();
     }
     SDL_RenderPresent(renderer);
-    SDL_Delay(8);
 }
 
 
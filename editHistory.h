@@ -0,0 +1,151 @@
+#ifndef EDIT_HISTORY_H
+#define EDIT_HISTORY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Undo/redo log for a tile grid addressed by flat index (y * width + x).
+// Every stroke becomes one entry holding run-length encoded deltas: a run of
+// consecutive indices that all went from the same old type to the same new
+// type is stored once, so a large fill costs a handful of runs instead of a
+// grid snapshot. The oldest entries are dropped once the log grows past
+// maxBytes.
+class EditHistory {
+public:
+    struct Run {
+        int32_t start;
+        int32_t length;
+        int16_t oldValue;
+        int16_t newValue;
+    };
+
+    explicit EditHistory(size_t maxBytes = 16 * 1024 * 1024) : budget(maxBytes), bytes(0), recording(false) {}
+
+    void BeginStroke() {
+        pending.clear();
+        recording = true;
+    }
+
+    // Call for every tile the stroke changes, in any order.
+    void Record(int index, int oldValue, int newValue) {
+        if (recording && oldValue != newValue) {
+            pending.push_back({index, static_cast<int16_t>(oldValue), static_cast<int16_t>(newValue)});
+        }
+    }
+
+    // Returns false if the stroke changed nothing.
+    bool EndStroke() {
+        recording = false;
+        if (pending.empty()) {
+            return false;
+        }
+        // Stable so that repeated touches of one tile keep their order: the
+        // first old value and the last new value win.
+        auto byIndex = [](const Change& a, const Change& b) { return a.index < b.index; };
+        if (!std::is_sorted(pending.begin(), pending.end(), byIndex)) {
+            std::stable_sort(pending.begin(), pending.end(), byIndex);
+        }
+        Entry entry;
+        for (size_t i = 0; i < pending.size();) {
+            size_t last = i;
+            while (last + 1 < pending.size() && pending[last + 1].index == pending[i].index) {
+                ++last;
+            }
+            int index = pending[i].index;
+            int16_t oldValue = pending[i].oldValue, newValue = pending[last].newValue;
+            i = last + 1;
+            if (oldValue == newValue) {
+                continue;
+            }
+            if (!entry.runs.empty()) {
+                Run& run = entry.runs.back();
+                if (run.start + run.length == index && run.oldValue == oldValue && run.newValue == newValue) {
+                    run.length++;
+                    continue;
+                }
+            }
+            entry.runs.push_back({index, 1, oldValue, newValue});
+        }
+        pending.clear();
+        if (entry.runs.empty()) {
+            return false;
+        }
+        entry.runs.shrink_to_fit();
+        for (const Entry& e : redoStack) {
+            bytes -= e.Bytes();
+        }
+        redoStack.clear();
+        bytes += entry.Bytes();
+        undoStack.push_back(std::move(entry));
+        while (bytes > budget && undoStack.size() > 1) {
+            bytes -= undoStack.front().Bytes();
+            undoStack.pop_front();
+        }
+        return true;
+    }
+
+    // The runs of the newest entry, e.g. right after EndStroke() succeeded.
+    const std::vector<Run>& LastRuns() const { return undoStack.back().runs; }
+
+    bool CanUndo() const { return !undoStack.empty(); }
+    bool CanRedo() const { return !redoStack.empty(); }
+
+    // apply(start, length, value) sets length tiles from start to value.
+    template <typename Apply>
+    bool Undo(Apply apply) {
+        if (undoStack.empty()) {
+            return false;
+        }
+        for (const Run& run : undoStack.back().runs) {
+            apply(run.start, run.length, run.oldValue);
+        }
+        redoStack.push_back(std::move(undoStack.back()));
+        undoStack.pop_back();
+        return true;
+    }
+
+    template <typename Apply>
+    bool Redo(Apply apply) {
+        if (redoStack.empty()) {
+            return false;
+        }
+        for (const Run& run : redoStack.back().runs) {
+            apply(run.start, run.length, run.newValue);
+        }
+        undoStack.push_back(std::move(redoStack.back()));
+        redoStack.pop_back();
+        return true;
+    }
+
+    void Clear() {
+        undoStack.clear();
+        redoStack.clear();
+        pending.clear();
+        bytes = 0;
+    }
+
+    size_t Bytes() const { return bytes; }
+
+private:
+    struct Change {
+        int32_t index;
+        int16_t oldValue;
+        int16_t newValue;
+    };
+    struct Entry {
+        std::vector<Run> runs;
+        size_t Bytes() const { return sizeof(Entry) + runs.capacity() * sizeof(Run); }
+    };
+
+    size_t budget;
+    size_t bytes;
+    bool recording;
+    std::vector<Change> pending;
+    std::deque<Entry> undoStack;
+    std::vector<Entry> redoStack;
+};
+
+#endif
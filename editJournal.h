@@ -0,0 +1,223 @@
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Append-only crash journal of grid edits since the last completed save.
+// Every edit is written as one record of (flat index, length, new value)
+// runs and flushed immediately; a record cut short by a crash is ignored on
+// replay. Starting a save rotates the journal: the current file becomes
+// path + ".prev" and a new one is started, and the .prev file is deleted
+// once the save is on disk. Replaying .prev and then the current file over
+// the last saved level therefore reproduces every edit, whether or not the
+// crash happened mid-save, because the runs store absolute values.
+// Indices only mean something for one grid size, so every file starts with
+// a header giving the width, height and layer count it was written for, and
+// Recover() refuses a journal that does not match the loaded level.
+// Journal files use the machine's byte order; they are not meant to move
+// between machines.
+class EditJournal {
+public:
+    struct Run {
+        int32_t start;
+        int32_t length;
+        int32_t value;
+    };
+
+    EditJournal() : file(nullptr), header() {}
+    ~EditJournal() { Close(); }
+
+    // After Recover() has accepted (and so removed) any earlier file; the
+    // header is written when the file is new.
+    bool Open(const std::string& journalPath, int width, int height, int layers) {
+        Close();
+        path = journalPath;
+        header = MakeHeader(width, height, layers);
+        file = fopen(path.c_str(), "ab");
+        if (file && fseek(file, 0, SEEK_END) == 0 && ftell(file) == 0) {
+            WriteHeader();
+        }
+        return file != nullptr;
+    }
+
+    void Close() {
+        if (file) {
+            fclose(file);
+            file = nullptr;
+        }
+    }
+
+    void Add(int start, int length, int value) {
+        pending.push_back({start, length, value});
+    }
+
+    // Writes the runs added since the last Commit() as one record.
+    void Commit() {
+        if (!file || pending.empty()) {
+            pending.clear();
+            return;
+        }
+        int32_t count = static_cast<int32_t>(pending.size());
+        fwrite(&count, sizeof(count), 1, file);
+        fwrite(pending.data(), sizeof(Run), pending.size(), file);
+        fflush(file);
+        pending.clear();
+    }
+
+    // Call when a save of the current state starts. If an earlier save never
+    // completed, its .prev file still holds unsaved edits, so the current
+    // file is appended to it instead of replacing it.
+    void Rotate() {
+        if (path.empty()) {
+            return;
+        }
+        Close();
+        std::string previous = path + ".prev";
+        FILE* prev = fopen(previous.c_str(), "rb");
+        if (prev) {
+            fclose(prev);
+            AppendFile(path, previous, sizeof(Header));
+            remove(path.c_str());
+        } else {
+            rename(path.c_str(), previous.c_str());
+        }
+        file = fopen(path.c_str(), "wb");
+        if (file) {
+            WriteHeader();
+        }
+    }
+
+    // Call when that save has reached the disk.
+    void SaveCompleted() {
+        if (path.empty()) {
+            return;
+        }
+        std::string previous = path + ".prev";
+        remove(previous.c_str());
+    }
+
+    // Startup, before Open(): applies every complete record from
+    // journalPath + ".prev" and then journalPath, via apply(start, length,
+    // value), and rewrites them as one clean .prev file so a torn record at
+    // the end cannot hide later ones. Returns the number of records, or -1
+    // if either file was written for a grid other than width x height x
+    // layers (or has no header); nothing is applied then and both files are
+    // left as they are.
+    template <typename Apply>
+    static int Recover(const std::string& journalPath, int width, int height, int layers, Apply apply) {
+        const Header expected = MakeHeader(width, height, layers);
+        std::string previous = journalPath + ".prev";
+        if (!HeaderMatches(previous, expected) || !HeaderMatches(journalPath, expected)) {
+            return -1;
+        }
+        std::string valid;
+        int records = ReplayFile(previous, apply, valid) + ReplayFile(journalPath, apply, valid);
+        remove(journalPath.c_str());
+        if (records == 0) {
+            remove(previous.c_str());
+            return 0;
+        }
+        FILE* out = fopen(previous.c_str(), "wb");
+        if (out) {
+            fwrite(&expected, sizeof(expected), 1, out);
+            fwrite(valid.data(), 1, valid.size(), out);
+            fclose(out);
+        }
+        return records;
+    }
+
+private:
+    static const int32_t MAX_RUNS = 1 << 24;
+
+    struct Header {
+        char magic[4];
+        int32_t width;
+        int32_t height;
+        int32_t layers;
+    };
+
+    std::string path;
+    FILE* file;
+    Header header;
+    std::vector<Run> pending;
+
+    static Header MakeHeader(int width, int height, int layers) {
+        Header h = {{'E', 'J', 'N', '1'}, width, height, layers};
+        return h;
+    }
+
+    void WriteHeader() {
+        fwrite(&header, sizeof(header), 1, file);
+        fflush(file);
+    }
+
+    // A missing file, or one cut short before its header was complete, has
+    // nothing to replay and matches anything.
+    static bool HeaderMatches(const std::string& filePath, const Header& expected) {
+        FILE* in = fopen(filePath.c_str(), "rb");
+        if (!in) {
+            return true;
+        }
+        Header h;
+        bool complete = fread(&h, sizeof(h), 1, in) == 1;
+        fclose(in);
+        return !complete || memcmp(&h, &expected, sizeof(h)) == 0;
+    }
+
+    // Appends from, minus its first skip bytes, to the end of to.
+    static void AppendFile(const std::string& from, const std::string& to, long skip) {
+        FILE* in = fopen(from.c_str(), "rb");
+        FILE* out = fopen(to.c_str(), "ab");
+        if (in && out && fseek(in, skip, SEEK_SET) == 0) {
+            char buffer[64 * 1024];
+            size_t got;
+            while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+                fwrite(buffer, 1, got, out);
+            }
+            fflush(out);
+        }
+        if (in) {
+            fclose(in);
+        }
+        if (out) {
+            fclose(out);
+        }
+    }
+
+    template <typename Apply>
+    static int ReplayFile(const std::string& filePath, Apply apply, std::string& valid) {
+        FILE* in = fopen(filePath.c_str(), "rb");
+        if (!in) {
+            return 0;
+        }
+        // Recover() has already checked the header.
+        Header h;
+        if (fread(&h, sizeof(h), 1, in) != 1) {
+            fclose(in);
+            return 0;
+        }
+        int records = 0;
+        int32_t count;
+        std::vector<Run> runs;
+        while (fread(&count, sizeof(count), 1, in) == 1 && count > 0 && count <= MAX_RUNS) {
+            runs.resize(count);
+            if (fread(runs.data(), sizeof(Run), count, in) != static_cast<size_t>(count)) {
+                break;
+            }
+            for (const Run& run : runs) {
+                apply(run.start, run.length, run.value);
+            }
+            valid.append(reinterpret_cast<const char*>(&count), sizeof(count));
+            valid.append(reinterpret_cast<const char*>(runs.data()), sizeof(Run) * runs.size());
+            ++records;
+        }
+        fclose(in);
+        return records;
+    }
+};
+
+#endif
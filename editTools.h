@@ -0,0 +1,123 @@
+#ifndef EDIT_TOOLS_H
+#define EDIT_TOOLS_H
+
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+// Grid rasterizers for the editor tools. They only compute which tiles a
+// tool covers; the caller's callbacks do the writing, so one tool use can be
+// applied (and recorded for undo) as a single batch. Coordinates are tiles.
+
+// Every tile on the line from (x0, y0) to (x1, y1), endpoints included.
+template <typename Plot>
+void BresenhamLine(int x0, int y0, int x1, int y1, Plot plot) {
+    int dx = std::abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+    int dy = -std::abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+    int err = dx + dy;
+    for (;;) {
+        plot(x0, y0);
+        if (x0 == x1 && y0 == y1) {
+            return;
+        }
+        int e2 = 2 * err;
+        if (e2 >= dy) {
+            err += dy;
+            x0 += sx;
+        }
+        if (e2 <= dx) {
+            err += dx;
+            y0 += sy;
+        }
+    }
+}
+
+// Filled rectangle between two corners in any order, clipped to the grid;
+// span(y, xFirst, xLast) is called once per row.
+template <typename Span>
+void RectFill(int x0, int y0, int x1, int y1, int width, int height, Span span) {
+    if (x0 > x1) {
+        std::swap(x0, x1);
+    }
+    if (y0 > y1) {
+        std::swap(y0, y1);
+    }
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 >= width ? width - 1 : x1;
+    y1 = y1 >= height ? height - 1 : y1;
+    for (int y = y0; y <= y1 && x0 <= x1; ++y) {
+        span(y, x0, x1);
+    }
+}
+
+// Rectangle border between two corners in any order, each tile once.
+template <typename Plot>
+void RectOutline(int x0, int y0, int x1, int y1, Plot plot) {
+    if (x0 > x1) {
+        std::swap(x0, x1);
+    }
+    if (y0 > y1) {
+        std::swap(y0, y1);
+    }
+    for (int x = x0; x <= x1; ++x) {
+        plot(x, y0);
+        if (y1 != y0) {
+            plot(x, y1);
+        }
+    }
+    for (int y = y0 + 1; y < y1; ++y) {
+        plot(x0, y);
+        if (x1 != x0) {
+            plot(x1, y);
+        }
+    }
+}
+
+// Scanline flood fill of the 4-connected region of the tile type found at
+// (x, y). get(x, y) reads the grid and span(y, xFirst, xLast) must write
+// replacement into that run before returning, since later reads rely on it.
+// Seeds live on a heap vector, so region size is not limited by the stack.
+template <typename Get, typename Span>
+void ScanlineFill(int x, int y, int width, int height, int replacement, Get get, Span span) {
+    if (x < 0 || x >= width || y < 0 || y >= height) {
+        return;
+    }
+    const int target = get(x, y);
+    if (target == replacement) {
+        return;
+    }
+    std::vector<std::pair<int, int>> seeds;
+    seeds.push_back({x, y});
+    while (!seeds.empty()) {
+        int sx = seeds.back().first, sy = seeds.back().second;
+        seeds.pop_back();
+        if (get(sx, sy) != target) {
+            continue;
+        }
+        int left = sx, right = sx;
+        while (left > 0 && get(left - 1, sy) == target) {
+            --left;
+        }
+        while (right < width - 1 && get(right + 1, sy) == target) {
+            ++right;
+        }
+        span(sy, left, right);
+        // One seed per run of matching tiles directly above and below.
+        for (int ny = sy - 1; ny <= sy + 1; ny += 2) {
+            if (ny < 0 || ny >= height) {
+                continue;
+            }
+            bool inRun = false;
+            for (int nx = left; nx <= right; ++nx) {
+                bool match = get(nx, ny) == target;
+                if (match && !inRun) {
+                    seeds.push_back({nx, ny});
+                }
+                inRun = match;
+            }
+        }
+    }
+}
+
+#endif
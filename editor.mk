@@ -1,2 +1,5 @@
 le:
-	g++ -I src/include -L src/lib -o le le.cpp -lmingw32 -lSDL2main -lSDL2 -lSDL2_image
\ No newline at end of file
+	g++ -pthread -I src/include -L src/lib -o le le.cpp -lmingw32 -lSDL2main -lSDL2 -lSDL2_image
+
+levelTool:
+	g++ -std=c++17 -O2 -pthread -o levelTool levelTool.cpp
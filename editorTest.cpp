@@ -0,0 +1,530 @@
+#include "autotile.h"
+#include "editHistory.h"
+#include "editJournal.h"
+#include "editTools.h"
+#include "levelIO.h"
+#include "levelLayers.h"
+#include "tileGrid.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Headless checks for the editor's data code. Everything runs against simple
+// reference implementations on seeded random maps, so a failure is
+// reproducible. Exits non-zero if any check fails.
+
+static const int TILE_TYPES = 6;
+// Undo and redo of a 100k-tile fill must stay interactive.
+static const double LARGE_FILL_BUDGET_MS = 20.0;
+static const char* const TEMP_LEVEL = "editorTest_level.tmp";
+static const char* const TEMP_JOURNAL = "editorTest.journal";
+
+static int failures = 0;
+
+static void expect(bool ok, const string& what) {
+    if (!ok) {
+        cout << "FAIL: " << what << endl;
+        ++failures;
+    }
+}
+
+// The editor's grid as EditHistory sees it: flat indices, y * width + x.
+struct Map {
+    int width, height;
+    vector<int> tiles;
+
+    Map(int w, int h, int fill = 0) : width(w), height(h), tiles(static_cast<size_t>(w) * h, fill) {}
+    bool Contains(int x, int y) const { return x >= 0 && x < width && y >= 0 && y < height; }
+    int Get(int x, int y) const { return tiles[static_cast<size_t>(y) * width + x]; }
+    void Set(int x, int y, int value) { tiles[static_cast<size_t>(y) * width + x] = value; }
+};
+
+static Map RandomMap(mt19937& rng, int width, int height, int types) {
+    Map map(width, height);
+    for (int& tile : map.tiles) {
+        tile = rng() % types;
+    }
+    return map;
+}
+
+static TileGrid RandomGrid(mt19937& rng, int width, int height, int types) {
+    TileGrid grid(width, height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            grid.Set(x, y, rng() % types);
+        }
+    }
+    return grid;
+}
+
+static bool SameGrid(const TileGrid& a, const TileGrid& b) {
+    if (a.Width() != b.Width() || a.Height() != b.Height()) {
+        return false;
+    }
+    for (int y = 0; y < a.Height(); ++y) {
+        if (a.Row(y) != b.Row(y)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool SameLevel(const Level& a, const Level& b) {
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        if (!SameGrid(a.layers[layer], b.layers[layer])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Reference 4-connected flood fill.
+static vector<bool> FloodRegion(const Map& map, int x, int y) {
+    const int target = map.Get(x, y);
+    vector<bool> region(map.tiles.size(), false);
+    vector<pair<int, int>> stack = {{x, y}};
+    region[static_cast<size_t>(y) * map.width + x] = true;
+    while (!stack.empty()) {
+        pair<int, int> p = stack.back();
+        stack.pop_back();
+        const int dx[] = {1, -1, 0, 0}, dy[] = {0, 0, 1, -1};
+        for (int d = 0; d < 4; ++d) {
+            int nx = p.first + dx[d], ny = p.second + dy[d];
+            size_t index = static_cast<size_t>(ny) * map.width + nx;
+            if (map.Contains(nx, ny) && !region[index] && map.Get(nx, ny) == target) {
+                region[index] = true;
+                stack.push_back({nx, ny});
+            }
+        }
+    }
+    return region;
+}
+
+// Random brush drags, lines and rectangles recorded like the editor does,
+// then undone and redone all the way while comparing against the map after
+// every stroke.
+static void CheckHistory(mt19937& rng) {
+    const int width = 64, height = 48;
+    Map map = RandomMap(rng, width, height, TILE_TYPES);
+    EditHistory history;
+    int applied = 0;
+    auto apply = [&](int start, int length, int value) {
+        for (int i = start; i < start + length; ++i) {
+            map.tiles[i] = value;
+        }
+        ++applied;
+    };
+    auto set = [&](int x, int y, int value) {
+        history.Record(y * width + x, map.Get(x, y), value);
+        map.Set(x, y, value);
+    };
+
+    vector<vector<int>> states = {map.tiles};
+    for (int stroke = 0; stroke < 200; ++stroke) {
+        history.BeginStroke();
+        int value = rng() % TILE_TYPES, x = rng() % width, y = rng() % height;
+        int x1 = rng() % width, y1 = rng() % height;
+        switch (rng() % 3) {
+            case 0:
+                // A brush drag that crosses its own path.
+                for (int i = 0; i < 30; ++i) {
+                    set((x + i % 7) % width, (y + i / 7) % height, (value + i) % TILE_TYPES);
+                }
+                break;
+            case 1:
+                // A line, drawn from its far end.
+                for (int i = 64; i >= 0; --i) {
+                    set(x + (x1 - x) * i / 64, y + (y1 - y) * i / 64, value);
+                }
+                break;
+            default:
+                for (int ry = min(y, y1); ry <= max(y, y1); ++ry) {
+                    for (int rx = min(x, x1); rx <= max(x, x1); ++rx) {
+                        set(rx, ry, value);
+                    }
+                }
+                break;
+        }
+        if (history.EndStroke()) {
+            states.push_back(map.tiles);
+        }
+    }
+    bool ok = true;
+    for (size_t i = states.size() - 1; i > 0 && ok; --i) {
+        ok = history.Undo(apply) && map.tiles == states[i - 1];
+    }
+    expect(ok && !history.CanUndo(), "undo does not restore every earlier map");
+    for (size_t i = 1; i < states.size() && ok; ++i) {
+        ok = history.Redo(apply) && map.tiles == states[i];
+    }
+    expect(ok && !history.CanRedo(), "redo does not restore every later map");
+
+    // A new stroke after undo drops the redo entries.
+    history.Undo(apply);
+    history.BeginStroke();
+    set(0, 0, (map.Get(0, 0) + 1) % TILE_TYPES);
+    history.EndStroke();
+    expect(!history.CanRedo(), "a new stroke leaves redo entries behind");
+
+    // Run merging, counted through the runs Undo() applies: a full-width
+    // fill over one type is a single run, and a tile touched twice keeps its
+    // first old and last new value.
+    map = Map(width, height, 1);
+    history.Clear();
+    history.BeginStroke();
+    for (int y = 10; y < 20; ++y) {
+        for (int x = 0; x < width; ++x) {
+            set(x, y, 2);
+        }
+    }
+    history.EndStroke();
+    applied = 0;
+    history.Undo(apply);
+    expect(applied == 1 && map.tiles == Map(width, height, 1).tiles, "a full-width fill is not one run");
+    history.Redo(apply);
+    history.BeginStroke();
+    set(5, 5, 3);
+    set(5, 5, 4);
+    set(3, 5, 4);
+    set(4, 5, 4);
+    history.EndStroke();
+    applied = 0;
+    history.Undo(apply);
+    ok = applied == 1 && map.Get(3, 5) == 1 && map.Get(4, 5) == 1 && map.Get(5, 5) == 1;
+    history.Redo(apply);
+    expect(ok && map.Get(3, 5) == 4 && map.Get(5, 5) == 4, "repeated and out-of-order touches do not merge into one run");
+    history.BeginStroke();
+    set(7, 7, 5);
+    set(7, 7, 1);
+    expect(!history.EndStroke(), "a stroke that puts every tile back records an entry");
+
+    // Past the budget the oldest entries go, but never the newest.
+    EditHistory small(256);
+    for (int i = 0; i < 50; ++i) {
+        small.BeginStroke();
+        small.Record(i, 1, 2);
+        small.EndStroke();
+    }
+    expect(small.Bytes() <= 256 && small.CanUndo(), "history grows past its budget");
+}
+
+// A fill of over 100k tiles around scattered obstacles on a 1000x1000 map:
+// undo and redo must take milliseconds, and the entry must be far smaller
+// than a snapshot of the map.
+static void CheckLargeFill(mt19937& rng) {
+    const int size = 1000;
+    Map map(size, size);
+    for (int& tile : map.tiles) {
+        tile = rng() % 20 == 0 ? 1 : 0;
+    }
+    // A fence around a 400x300 area.
+    for (int x = 99; x <= 500; ++x) {
+        map.Set(x, 99, 2);
+        map.Set(x, 400, 2);
+    }
+    for (int y = 99; y <= 400; ++y) {
+        map.Set(99, y, 2);
+        map.Set(500, y, 2);
+    }
+    map.Set(100, 100, 0);
+    const vector<bool> region = FloodRegion(map, 100, 100);
+    const vector<int> before = map.tiles;
+
+    EditHistory history;
+    auto apply = [&](int start, int length, int value) { fill(map.tiles.begin() + start, map.tiles.begin() + start + length, value); };
+    size_t filled = 0;
+    auto start = chrono::steady_clock::now();
+    history.BeginStroke();
+    for (size_t i = 0; i < region.size(); ++i) {
+        if (region[i]) {
+            history.Record(static_cast<int>(i), map.tiles[i], 3);
+            map.tiles[i] = 3;
+            ++filled;
+        }
+    }
+    history.EndStroke();
+    auto recorded = chrono::steady_clock::now();
+    const vector<int> after = map.tiles;
+    auto undoStart = chrono::steady_clock::now();
+    bool undone = history.Undo(apply) && map.tiles == before;
+    auto undoEnd = chrono::steady_clock::now();
+    bool redone = history.Redo(apply) && map.tiles == after;
+    auto redoEnd = chrono::steady_clock::now();
+
+    auto ms = [](chrono::steady_clock::time_point a, chrono::steady_clock::time_point b) {
+        return chrono::duration<double, milli>(b - a).count();
+    };
+    const double undoMs = ms(undoStart, undoEnd), redoMs = ms(undoEnd, redoEnd);
+    const size_t snapshotBytes = map.tiles.size() * sizeof(int);
+    cout << filled << "-tile fill: recorded in " << ms(start, recorded) << " ms, undo " << undoMs << " ms, redo " << redoMs << " ms, "
+         << history.Bytes() / 1024 << " KiB of history (map snapshot " << snapshotBytes / 1024 << " KiB)" << endl;
+    expect(filled >= 100000, "the large fill covers fewer than 100k tiles");
+    expect(undone && redone, "undo or redo of the large fill does not restore the map");
+    expect(undoMs < LARGE_FILL_BUDGET_MS && redoMs < LARGE_FILL_BUDGET_MS,
+           "undo or redo of the large fill takes more than " + to_string(LARGE_FILL_BUDGET_MS) + " ms");
+    expect(history.Bytes() < snapshotBytes / 8, "the large fill's history entry is not much smaller than a map snapshot");
+}
+
+// ScanlineFill on maps with obstacles must change exactly the region the
+// reference finds, writing each tile once.
+static void CheckFill(mt19937& rng) {
+    for (int round = 0; round < 40; ++round) {
+        const int width = 20 + rng() % 100, height = 20 + rng() % 80;
+        // Few types so regions are large and ragged.
+        Map map = RandomMap(rng, width, height, 2 + round % 3);
+        const int x = rng() % width, y = rng() % height, replacement = 9;
+        const vector<bool> region = FloodRegion(map, x, y);
+        const Map before = map;
+        size_t written = 0;
+        ScanlineFill(x, y, width, height, replacement, [&](int gx, int gy) { return map.Get(gx, gy); },
+                     [&](int row, int first, int last) {
+                         for (int gx = first; gx <= last; ++gx) {
+                             map.Set(gx, row, replacement);
+                         }
+                         written += last - first + 1;
+                     });
+        size_t regionSize = 0;
+        bool ok = true;
+        for (size_t i = 0; i < map.tiles.size(); ++i) {
+            regionSize += region[i] ? 1 : 0;
+            ok = ok && map.tiles[i] == (region[i] ? replacement : before.tiles[i]);
+        }
+        expect(ok, "fill on obstacle map " + to_string(round) + " differs from the reference region");
+        expect(written == regionSize, "fill on obstacle map " + to_string(round) + " wrote tiles more than once");
+    }
+
+    // A one-tile-wide serpentine corridor, the worst case for a recursive
+    // fill, must be filled end to end.
+    const int size = 401;
+    Map maze(size, size, 1);
+    for (int y = 0; y < size; y += 2) {
+        for (int x = 0; x < size; ++x) {
+            maze.Set(x, y, 0);
+        }
+        if (y + 1 < size) {
+            maze.Set((y / 2) % 2 == 0 ? size - 1 : 0, y + 1, 0);
+        }
+    }
+    ScanlineFill(0, 0, size, size, 2, [&](int x, int y) { return maze.Get(x, y); },
+                 [&](int row, int first, int last) {
+                     for (int x = first; x <= last; ++x) {
+                         maze.Set(x, row, 2);
+                     }
+                 });
+    expect(maze.Get(size - 1, size - 1) == 2 && maze.Get(1, 1) == 1, "serpentine corridor is not filled end to end");
+}
+
+static void RemoveJournal() {
+    remove(TEMP_JOURNAL);
+    remove((string(TEMP_JOURNAL) + ".prev").c_str());
+}
+
+static string ReadAll(const string& path) {
+    ifstream in(path, ios::binary);
+    return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+}
+
+// Edits journaled across a save that never completed, followed by a record
+// torn by the crash, must replay onto the saved map as exactly the complete
+// records. Recovery leaves one clean .prev file that replays the same way,
+// and a completed save drops what it covered. A journal written for another
+// grid size, or without a header, is refused and left byte for byte as it
+// was.
+static void CheckJournal(mt19937& rng) {
+    const int width = 50, height = 40;
+    const Map saved = RandomMap(rng, width, height, TILE_TYPES);
+    Map expected = saved;
+    RemoveJournal();
+    EditJournal journal;
+    expect(journal.Open(TEMP_JOURNAL, width, height, 1), "journal does not open");
+    auto record = [&](int records) {
+        for (int r = 0; r < records; ++r) {
+            const int runs = 1 + rng() % 4;
+            for (int i = 0; i < runs; ++i) {
+                int start = rng() % (width * height), length = 1 + rng() % 30, value = rng() % TILE_TYPES;
+                length = min(length, width * height - start);
+                journal.Add(start, length, value);
+                fill(expected.tiles.begin() + start, expected.tiles.begin() + start + length, value);
+            }
+            journal.Commit();
+        }
+    };
+    record(20);
+    journal.Rotate();
+    record(15);
+    journal.Close();
+    FILE* torn = fopen(TEMP_JOURNAL, "ab");
+    const int32_t count = 3;
+    const int32_t partial[4] = {0, width * height, 5, 0};
+    fwrite(&count, sizeof(count), 1, torn);
+    fwrite(partial, sizeof(partial), 1, torn);
+    fclose(torn);
+
+    auto replayAs = [&](Map& map, int w, int h) {
+        return EditJournal::Recover(TEMP_JOURNAL, w, h, 1, [&](int start, int length, int value) {
+            fill(map.tiles.begin() + start, map.tiles.begin() + start + length, value);
+        });
+    };
+    auto replay = [&](Map& map) { return replayAs(map, width, height); };
+
+    const string prevPath = string(TEMP_JOURNAL) + ".prev";
+    const string currentBytes = ReadAll(TEMP_JOURNAL), prevBytes = ReadAll(prevPath);
+    const int mismatched[][2] = {{width + 1, height}, {width, height - 1}, {height, width}};
+    for (const auto& size : mismatched) {
+        Map untouched = saved;
+        int result = replayAs(untouched, size[0], size[1]);
+        expect(result == -1 && untouched.tiles == saved.tiles && ReadAll(TEMP_JOURNAL) == currentBytes && ReadAll(prevPath) == prevBytes,
+               "a journal for " + to_string(width) + "x" + to_string(height) + " replays onto " + to_string(size[0]) + "x" +
+                   to_string(size[1]) + " or is changed");
+    }
+    Map untouched = saved;
+    int layersResult = EditJournal::Recover(TEMP_JOURNAL, width, height, 3, [&](int, int, int) { untouched.tiles[0] = -1; });
+    expect(layersResult == -1 && untouched.tiles == saved.tiles, "a journal for one layer replays onto three");
+
+    Map recovered = saved;
+    int records = replay(recovered);
+    expect(records == 35 && recovered.tiles == expected.tiles,
+           "journal replay gives " + to_string(records) + " records and a different map, expected 35");
+    Map again = saved;
+    records = replay(again);
+    expect(records == 35 && again.tiles == expected.tiles, "the rewritten journal does not replay the same way");
+
+    // Once a save of the recovered map completes, only later edits replay.
+    const Map resaved = expected;
+    journal.Open(TEMP_JOURNAL, width, height, 1);
+    journal.Rotate();
+    journal.SaveCompleted();
+    record(5);
+    journal.Close();
+    Map afterSave = resaved;
+    records = replay(afterSave);
+    expect(records == 5 && afterSave.tiles == expected.tiles, "a completed save does not drop the records it covered");
+
+    // A journal from before headers existed starts straight with a record.
+    RemoveJournal();
+    FILE* legacy = fopen(TEMP_JOURNAL, "wb");
+    const int32_t one = 1;
+    const int32_t run[3] = {0, 10, 1};
+    fwrite(&one, sizeof(one), 1, legacy);
+    fwrite(run, sizeof(run), 1, legacy);
+    fclose(legacy);
+    const string legacyBytes = ReadAll(TEMP_JOURNAL);
+    Map legacyMap = saved;
+    records = replay(legacyMap);
+    expect(records == -1 && legacyMap.tiles == saved.tiles && ReadAll(TEMP_JOURNAL) == legacyBytes, "a journal without a header is replayed");
+    RemoveJournal();
+}
+
+// Every format must read back what it wrote: text, LVB1 for collision-only
+// levels and LVB2 for layered ones. No truncated binary file may parse; text
+// cut short keeps its complete rows.
+static void CheckLevelIO(mt19937& rng) {
+    Level collisionOnly;
+    collisionOnly.layers[LAYER_COLLISION] = RandomGrid(rng, 57, 31, TILE_TYPES);
+    collisionOnly.layers[LAYER_COLLISION].Set(3, 4, -7);
+    collisionOnly.layers[LAYER_COLLISION].Set(9, 2, 1234);
+    collisionOnly.Normalize();
+    Level layered = collisionOnly.Clone();
+    layered.layers[LAYER_BACKGROUND] = RandomGrid(rng, 57, 31, 4);
+    layered.layers[LAYER_FOREGROUND] = RandomGrid(rng, 57, 31, 3);
+    layered.Normalize();
+
+    const Level* levels[] = {&collisionOnly, &layered};
+    for (const Level* level : levels) {
+        const string name = level == &collisionOnly ? "collision-only" : "layered";
+        Level read;
+        expect(WriteFileAtomic(TEMP_LEVEL, FormatLevelText(*level)) && ReadLevel(TEMP_LEVEL, read) && SameLevel(read, *level),
+               name + " text round trip");
+        const string text = FormatLevelText(*level);
+        bool ok = true;
+        for (size_t length = text.size() / 3; length < text.size() && ok; length += text.size() / 7) {
+            Level cut;
+            ok = WriteFileAtomic(TEMP_LEVEL, text.substr(0, length)) && ReadLevel(TEMP_LEVEL, cut);
+            const TileGrid& grid = cut.Collision();
+            for (int y = 0; ok && y + 1 < grid.Height(); ++y) {
+                ok = grid.Row(y) == level->Collision().Row(y);
+            }
+            for (int layer = 0; ok && layer < LAYER_COUNT; ++layer) {
+                ok = cut.layers[layer].Width() == grid.Width() && cut.layers[layer].Height() == grid.Height();
+            }
+        }
+        expect(ok, name + " truncated text does not read back its complete rows");
+
+        const string binary = FormatLevelBinary(*level);
+        expect(memcmp(binary.data(), level == &collisionOnly ? LEVEL_BINARY_MAGIC : LEVEL_LAYERS_MAGIC, 4) == 0,
+               name + " binary uses the wrong magic");
+        read = Level();
+        expect(ParseLevelBinary(binary, read) && SameLevel(read, *level), name + " binary round trip");
+        read = Level();
+        expect(WriteFileAtomic(TEMP_LEVEL, binary) && ReadLevel(TEMP_LEVEL, read) && SameLevel(read, *level),
+               name + " binary file round trip");
+        size_t accepted = 0;
+        for (size_t length = 0; length < binary.size(); ++length) {
+            accepted += ParseLevelBinary(binary.substr(0, length), read) ? 1 : 0;
+        }
+        expect(accepted == 0, name + " binary: " + to_string(accepted) + " truncated prefixes parsed");
+    }
+    remove(TEMP_LEVEL);
+
+    // Runs that fall short of the grid.
+    string shortRuns(LEVEL_BINARY_MAGIC, 4);
+    PutLittle32(shortRuns, 10);
+    PutLittle32(shortRuns, 10);
+    PutLittle32(shortRuns, 1);
+    PutLittle32(shortRuns, 99);
+    PutLittle32(shortRuns, 1);
+    Level read;
+    expect(!ParseLevelBinary(shortRuns, read), "runs that fall short of the grid parse");
+    // A huge header with nothing behind it must fail without allocating.
+    string bomb(LEVEL_BINARY_MAGIC, 4);
+    PutLittle32(bomb, 1);
+    PutLittle32(bomb, 1u << 30);
+    PutLittle32(bomb, 0);
+    expect(!ParseLevelBinary(bomb, read), "a huge header with no runs parses");
+}
+
+// After any sequence of edits, Update() must leave the same variants as a
+// fresh Build() and report every cell whose variant changed.
+static void CheckAutotile(mt19937& rng) {
+    const int width = 40, height = 30;
+    TileGrid grid = RandomGrid(rng, width, height, 4);
+    Autotiler incremental;
+    incremental.Build(grid);
+    bool ok = true, reported = true;
+    for (int edit = 0; edit < 3000 && ok && reported; ++edit) {
+        int x = rng() % width, y = rng() % height;
+        const Autotiler before = incremental;
+        grid.Set(x, y, rng() % 4);
+        vector<bool> changed(static_cast<size_t>(width) * height, false);
+        incremental.Update(grid, x, y, [&](int cx, int cy) { changed[static_cast<size_t>(cy) * width + cx] = true; });
+        Autotiler built;
+        built.Build(grid);
+        for (int cy = 0; cy < height; ++cy) {
+            for (int cx = 0; cx < width; ++cx) {
+                ok = ok && incremental.Variant(cx, cy) == built.Variant(cx, cy);
+                reported = reported && (before.Variant(cx, cy) == built.Variant(cx, cy) || changed[static_cast<size_t>(cy) * width + cx]);
+            }
+        }
+    }
+    expect(ok, "Autotiler::Update() differs from Build()");
+    expect(reported, "Autotiler::Update() misses a changed cell");
+}
+
+int main() {
+    mt19937 rng(4321);
+    CheckHistory(rng);
+    CheckLargeFill(rng);
+    CheckFill(rng);
+    CheckJournal(rng);
+    CheckLevelIO(rng);
+    CheckAutotile(rng);
+    cout << (failures == 0 ? "PASS: editor checks" : "FAIL") << endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,2 @@
+editorTest:
+	g++ -std=c++17 -O2 -o editorTest editorTest.cpp
@@ -0,0 +1,83 @@
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <atomic>
+#include <functional>
+#include <vector>
+#include "mpscRing.h"
+
+enum GameEventType {
+    EVENT_DEATH,
+    EVENT_RESPAWN,
+    EVENT_WIN,
+    EVENT_JUMP,
+    EVENT_LAND,
+    EVENT_TILE_CHANGED,
+    EVENT_TYPE_COUNT
+};
+
+// Plain data so it can sit in the ring. x/y are pixels for player events and
+// the top-left tile of the changed area for EVENT_TILE_CHANGED, which covers
+// all collision edits of one live-link poll; value is lives left for deaths
+// and the number of tiles changed for tile changes.
+struct GameEvent {
+    GameEventType type;
+    int x, y, value;
+};
+
+// Gameplay events are emitted from any thread (the simulation thread in
+// practice) without locking or allocating, and handed to subscribers when
+// the owning thread calls Drain() once per frame.
+// Events are notifications (sounds, stats, logging) and are dropped when the
+// ring is full, so nothing that must happen -- such as ending the run -- may
+// depend on one being delivered.
+class EventBus {
+public:
+    typedef std::function<void(const GameEvent&)> Handler;
+
+    EventBus() : dropped(0) {}
+
+    // Setup only: subscribe before anyone starts emitting.
+    void Subscribe(GameEventType type, Handler handler) {
+        handlers[type].push_back(std::move(handler));
+    }
+    void SubscribeAll(const Handler& handler) {
+        for (int t = 0; t < EVENT_TYPE_COUNT; ++t) {
+            handlers[t].push_back(handler);
+        }
+    }
+
+    // Returns false and counts the event as dropped if the ring is full.
+    bool Emit(GameEventType type, int x, int y, int value) {
+        GameEvent e = {type, x, y, value};
+        if (!queue.TryPush(e)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    // Dispatches everything queued so far; returns the number of events.
+    size_t Drain() {
+        size_t count = 0;
+        GameEvent e;
+        while (queue.TryPop(e)) {
+            for (const Handler& h : handlers[e.type]) {
+                h(e);
+            }
+            ++count;
+        }
+        return count;
+    }
+
+    unsigned long long Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    static const size_t QUEUE_SIZE = 1024;
+
+    MpscRing<GameEvent, QUEUE_SIZE> queue;
+    std::vector<Handler> handlers[EVENT_TYPE_COUNT];
+    std::atomic<unsigned long long> dropped;
+};
+
+#endif
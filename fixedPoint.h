@@ -0,0 +1,75 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <cstdint>
+
+// 16.16 fixed-point number for the physics code. Everything is done with
+// integer multiplies and divisions (never floats, never shifts of negative
+// values), so results are bit-identical on every compiler and at every
+// optimization level -- which is what replays and lockstep rely on. For the
+// same reason nothing may overflow a signed int32_t, which is undefined
+// behaviour the optimiser is free to exploit: every operation is computed in
+// int64_t and saturates to the representable range. Division by zero
+// saturates toward the sign of the dividend (0 / 0 is 0).
+struct Fixed {
+    static const int32_t FRACTION_BITS = 16;
+    static const int32_t ONE = 1 << FRACTION_BITS;
+    // Integer range FromInt() represents exactly.
+    static const int32_t MAX_INT = INT32_MAX / ONE;
+    static const int32_t MIN_INT = INT32_MIN / ONE;
+
+    int32_t raw;
+
+    constexpr Fixed() : raw(0) {}
+
+    static constexpr Fixed FromRaw(int32_t r) { return Fixed(r, 0); }
+    static constexpr Fixed Saturate(int64_t r) {
+        return r > INT32_MAX ? Fixed(INT32_MAX, 0) : (r < INT32_MIN ? Fixed(INT32_MIN, 0) : Fixed(static_cast<int32_t>(r), 0));
+    }
+    // num / den rounded toward zero, saturating.
+    static constexpr Fixed Divide(int64_t num, int64_t den) {
+        return den != 0 ? Saturate(num / den) : Saturate(num > 0 ? INT64_MAX : (num < 0 ? INT64_MIN : 0));
+    }
+    // Saturates outside [MIN_INT, MAX_INT] instead of wrapping.
+    static constexpr Fixed FromInt(int32_t i) { return Saturate(static_cast<int64_t>(i) * ONE); }
+    // num/den, rounded toward zero; FromRatio(3, 4) is 0.75.
+    static constexpr Fixed FromRatio(int32_t num, int32_t den) { return Divide(static_cast<int64_t>(num) * ONE, den); }
+
+    // Largest integer <= value.
+    constexpr int32_t FloorToInt() const {
+        return raw >= 0 ? raw / ONE : -1 - (-(raw + 1)) / ONE;
+    }
+
+    constexpr Fixed operator+(Fixed o) const { return Saturate(static_cast<int64_t>(raw) + o.raw); }
+    constexpr Fixed operator-(Fixed o) const { return Saturate(static_cast<int64_t>(raw) - o.raw); }
+    constexpr Fixed operator-() const { return Saturate(-static_cast<int64_t>(raw)); }
+    constexpr Fixed operator*(Fixed o) const { return Saturate(static_cast<int64_t>(raw) * o.raw / ONE); }
+    constexpr Fixed operator/(Fixed o) const { return Divide(static_cast<int64_t>(raw) * ONE, o.raw); }
+    constexpr Fixed operator*(int32_t i) const { return Saturate(static_cast<int64_t>(raw) * i); }
+    constexpr Fixed operator/(int32_t i) const { return Divide(raw, i); }
+
+    Fixed& operator+=(Fixed o) { return *this = *this + o; }
+    Fixed& operator-=(Fixed o) { return *this = *this - o; }
+
+    constexpr bool operator==(Fixed o) const { return raw == o.raw; }
+    constexpr bool operator!=(Fixed o) const { return raw != o.raw; }
+    constexpr bool operator<(Fixed o) const { return raw < o.raw; }
+    constexpr bool operator<=(Fixed o) const { return raw <= o.raw; }
+    constexpr bool operator>(Fixed o) const { return raw > o.raw; }
+    constexpr bool operator>=(Fixed o) const { return raw >= o.raw; }
+
+private:
+    constexpr Fixed(int32_t r, int) : raw(r) {}
+};
+
+inline constexpr Fixed Abs(Fixed v) {
+    return v.raw < 0 ? -v : v;
+}
+
+// Floor division for tile lookups, so positions left of or above the map
+// land on tile -1 instead of being truncated onto tile 0.
+inline constexpr int32_t FloorDiv(int32_t a, int32_t b) {
+    return a >= 0 ? a / b : -1 - (-(a + 1)) / b;
+}
+
+#endif
@@ -0,0 +1,2 @@
+fixedPointTest:
+	g++ -O2 -o fixedPointTest fixedPointTest.cpp
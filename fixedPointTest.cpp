@@ -0,0 +1,182 @@
+#include "fixedPoint.h"
+#include "playerPhysics.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// Headless determinism check for fixedPoint.h and playerPhysics.h. A fixed
+// input script is replayed on a small built-in map, with and without
+// substepping, and every tick's player state is hashed. The hashes and a few
+// checkpoint positions must match the golden values below on every compiler
+// and optimization level; a change to the physics that moves the player by
+// even one raw unit fails here. Run with --print to show the new values
+// after an intended change. Exits non-zero on any mismatch.
+
+static const int TILE = 32;
+static const int MAP_WIDTH = 40;
+static const int MAP_HEIGHT = 19;
+static const int TICKS = 720;
+static const int CHECKPOINT_EVERY = 120;
+static const int CHECKPOINTS = TICKS / CHECKPOINT_EVERY;
+
+struct Checkpoint {
+    int32_t x, y, velocityY;
+};
+
+struct Golden {
+    const char* name;
+    SubstepConfig substeps;
+    uint64_t hash;
+    int landings;
+    Checkpoint checkpoints[CHECKPOINTS];
+};
+
+// Ground along row 15, a three-tile step, a wall to jump over and a low
+// ceiling to bump into.
+static CollisionMask BuildMap() {
+    TileGrid grid(MAP_WIDTH, MAP_HEIGHT);
+    for (int x = 0; x < MAP_WIDTH; ++x) {
+        grid.Set(x, 15, 1);
+    }
+    for (int x = 10; x < 13; ++x) {
+        grid.Set(x, 14, 2);
+    }
+    grid.Set(18, 14, 1);
+    grid.Set(18, 13, 1);
+    for (int x = 24; x < 30; ++x) {
+        grid.Set(x, 11, 1);
+    }
+    CollisionMask solids;
+    solids.Build(grid);
+    return solids;
+}
+
+static PlayerInput ScriptedInput(int tick) {
+    PlayerInput input = {};
+    input.right = tick < 480;
+    input.left = tick >= 540 && tick < 660;
+    input.jump = tick % 75 == 20;
+    return input;
+}
+
+static uint64_t Mix(uint64_t hash, int32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        hash ^= static_cast<uint8_t>(static_cast<uint32_t>(value) >> (8 * i));
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t Replay(const CollisionMask& solids, const SubstepConfig& substeps, Checkpoint* checkpoints, int& landings) {
+    const PlayerTuning tuning = {Fixed::FromInt(3), Fixed::FromInt(15), Fixed::FromInt(1), TILE};
+    PlayerBody body = {Fixed::FromInt(2 * TILE), Fixed::FromInt(10 * TILE), Fixed(), true};
+    SubstepStats stats = {};
+    uint64_t hash = 14695981039346656037ull;
+    landings = 0;
+    for (int tick = 0; tick < TICKS; ++tick) {
+        PlayerStep step = StepPlayer(body, ScriptedInput(tick), tuning, substeps, solids, stats);
+        hash = Mix(hash, body.x.raw);
+        hash = Mix(hash, body.y.raw);
+        hash = Mix(hash, body.velocityY.raw);
+        landings += step.landed ? 1 : 0;
+        hash = Mix(hash, (body.jumping ? 1 : 0) | (step.landed ? 2 : 0) | (step.jumped ? 4 : 0));
+        if ((tick + 1) % CHECKPOINT_EVERY == 0) {
+            checkpoints[(tick + 1) / CHECKPOINT_EVERY - 1] = {body.x.raw, body.y.raw, body.velocityY.raw};
+        }
+    }
+    return hash;
+}
+
+static int CheckArithmetic() {
+    int failures = 0;
+    auto expect = [&](const char* what, int64_t got, int64_t want) {
+        if (got != want) {
+            cout << "FAIL: " << what << " = " << got << ", expected " << want << endl;
+            ++failures;
+        }
+    };
+    expect("FromRatio(3, 4)", Fixed::FromRatio(3, 4).raw, 49152);
+    expect("FromRatio(-1, 3)", Fixed::FromRatio(-1, 3).raw, -21845);
+    expect("1.5 * -2.25", (Fixed::FromRatio(3, 2) * Fixed::FromRatio(-9, 4)).raw, -221184);
+    expect("7 / 3", (Fixed::FromInt(7) / Fixed::FromInt(3)).raw, 152917);
+    expect("FloorToInt(-0.5)", Fixed::FromRatio(-1, 2).FloorToInt(), -1);
+    expect("FloorToInt(2.75)", Fixed::FromRatio(11, 4).FloorToInt(), 2);
+    expect("FloorDiv(-1, 32)", FloorDiv(-1, 32), -1);
+    expect("FloorDiv(64, 32)", FloorDiv(64, 32), 2);
+    expect("FromInt(MAX_INT)", Fixed::FromInt(Fixed::MAX_INT).FloorToInt(), 32767);
+    expect("FromInt(MIN_INT)", Fixed::FromInt(Fixed::MIN_INT).FloorToInt(), -32768);
+    expect("FromInt(40000)", Fixed::FromInt(40000).raw, INT32_MAX);
+    expect("FromInt(-40000)", Fixed::FromInt(-40000).raw, INT32_MIN);
+    const Fixed max = Fixed::FromRaw(INT32_MAX), min = Fixed::FromRaw(INT32_MIN), tiny = Fixed::FromRaw(1);
+    expect("MAX + tiny", (max + tiny).raw, INT32_MAX);
+    expect("MIN - tiny", (min - tiny).raw, INT32_MIN);
+    expect("-MIN", (-min).raw, INT32_MAX);
+    expect("MAX * 3", (max * 3).raw, INT32_MAX);
+    expect("MAX * -3", (max * -3).raw, INT32_MIN);
+    expect("MAX * MAX", (max * max).raw, INT32_MAX);
+    expect("MIN / -1", (min / -1).raw, INT32_MAX);
+    expect("MIN / -tiny", (min / -tiny).raw, INT32_MAX);
+    Fixed sum = max;
+    sum += tiny;
+    expect("MAX += tiny", sum.raw, INT32_MAX);
+    sum = min;
+    sum -= tiny;
+    expect("MIN -= tiny", sum.raw, INT32_MIN);
+    expect("FromRatio(1, 0)", Fixed::FromRatio(1, 0).raw, INT32_MAX);
+    expect("FromRatio(-1, 0)", Fixed::FromRatio(-1, 0).raw, INT32_MIN);
+    expect("FromRatio(0, 0)", Fixed::FromRatio(0, 0).raw, 0);
+    expect("1 / 0", (Fixed::FromInt(1) / Fixed()).raw, INT32_MAX);
+    expect("-1 / 0", (Fixed::FromInt(-1) / 0).raw, INT32_MIN);
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    const bool print = argc > 1 && strcmp(argv[1], "--print") == 0;
+    const Golden goldens[] = {
+        {"substeps 8px x8", {Fixed::FromInt(TILE / 4), 8}, 0x1556535f532849c8ull, 10,
+         {{23494656, 25427968, 589824}, {47087616, 29360128, 0}, {68485120, 29360128, 0},
+          {81854464, 23461888, -393216}, {70057984, 29360128, 0}, {58261504, 17039360, 589824}}},
+        {"no substeps", {Fixed::FromInt(1000), 1}, 0x68730822ace07996ull, 10,
+         {{23396352, 25427968, 589824}, {46989312, 29360128, 0}, {68485120, 29360128, 0},
+          {81854464, 23461888, -393216}, {70057984, 29360128, 0}, {58261504, 17039360, 589824}}},
+    };
+
+    int failures = CheckArithmetic();
+    const CollisionMask solids = BuildMap();
+    for (const Golden& golden : goldens) {
+        Checkpoint checkpoints[CHECKPOINTS] = {};
+        int landings = 0;
+        uint64_t hash = Replay(solids, golden.substeps, checkpoints, landings);
+        if (print) {
+            cout << golden.name << ": 0x" << hex << hash << dec << "ull, " << landings << " landings" << endl;
+            for (const Checkpoint& c : checkpoints) {
+                cout << "    {" << c.x << ", " << c.y << ", " << c.velocityY << "}," << endl;
+            }
+            continue;
+        }
+        bool ok = hash == golden.hash;
+        if (landings != golden.landings) {
+            cout << "FAIL: " << golden.name << " landed " << landings << " times, expected " << golden.landings << endl;
+            ok = false;
+        }
+        for (int i = 0; i < CHECKPOINTS; ++i) {
+            const Checkpoint& c = checkpoints[i];
+            const Checkpoint& want = golden.checkpoints[i];
+            if (c.x != want.x || c.y != want.y || c.velocityY != want.velocityY) {
+                cout << "FAIL: " << golden.name << " tick " << (i + 1) * CHECKPOINT_EVERY << " at (" << c.x << ", " << c.y << ", " << c.velocityY
+                     << "), expected (" << want.x << ", " << want.y << ", " << want.velocityY << ")" << endl;
+                ok = false;
+            }
+        }
+        if (!ok) {
+            cout << "FAIL: " << golden.name << " trajectory hash 0x" << hex << hash << ", expected 0x" << golden.hash << dec << endl;
+            ++failures;
+        }
+    }
+    if (!print) {
+        cout << (failures == 0 ? "PASS: fixed point and player trajectories match golden values" : "FAIL") << endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
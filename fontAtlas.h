@@ -0,0 +1,266 @@
+#ifndef FONT_ATLAS_H
+#define FONT_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "logger.h"
+
+// Printable ASCII glyphs of one TTF font, baked at a few pixel sizes into a
+// single texture. The first run rasterizes them with SDL_ttf and writes
+// font_atlas.bmp plus a metrics table (font_atlas.txt) next to the game;
+// later runs just load those two files. TextRenderer then draws strings as
+// quads out of that one texture.
+
+const int ATLAS_FIRST_CHAR = 32;
+const int ATLAS_LAST_CHAR = 126;
+const int ATLAS_GLYPHS = ATLAS_LAST_CHAR - ATLAS_FIRST_CHAR + 1;
+const int ATLAS_WIDTH = 1024;
+
+struct GlyphInfo {
+    SDL_Rect src;
+    int advance;
+};
+
+struct AtlasFace {
+    int size;
+    int lineHeight;
+    GlyphInfo glyphs[ATLAS_GLYPHS];
+};
+
+class FontAtlas {
+public:
+    FontAtlas() : texture(nullptr), width(0), height(0) {}
+    ~FontAtlas() { Release(); }
+
+    // Must run before the renderer that owns the texture is destroyed.
+    void Release() {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+    }
+
+    // Loads the baked atlas, or bakes it from fontFile if it is missing or
+    // was baked for different sizes.
+    bool Load(SDL_Renderer* renderer, const char* fontFile, const std::vector<int>& sizes,
+              const char* imageFile = "font_atlas.bmp", const char* metricsFile = "font_atlas.txt") {
+        SDL_Surface* surface = nullptr;
+        if (LoadMetrics(metricsFile, sizes)) {
+            surface = SDL_LoadBMP(imageFile);
+        }
+        if (!surface) {
+            surface = Bake(fontFile, sizes);
+            if (!surface) {
+                return false;
+            }
+            if (SDL_SaveBMP(surface, imageFile) != 0 || !SaveMetrics(metricsFile)) {
+                LOG_ERROR("Failed to save font atlas: {}", SDL_GetError());
+            }
+        }
+        texture = SDL_CreateTextureFromSurface(renderer, surface);
+        SDL_FreeSurface(surface);
+        if (!texture) {
+            LOG_ERROR("Failed to create font atlas texture: {}", SDL_GetError());
+            return false;
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        return true;
+    }
+
+    SDL_Texture* Texture() const { return texture; }
+    int Width() const { return width; }
+    int Height() const { return height; }
+
+    // Closest baked size that is not larger than size (or the smallest one).
+    const AtlasFace* Face(int size) const {
+        const AtlasFace* best = nullptr;
+        for (const AtlasFace& f : faces) {
+            if (f.size <= size && (!best || f.size > best->size)) {
+                best = &f;
+            }
+        }
+        if (!best && !faces.empty()) {
+            best = &faces.front();
+        }
+        return best;
+    }
+
+private:
+    SDL_Texture* texture;
+    int width, height;
+    std::vector<AtlasFace> faces;
+
+    SDL_Surface* Bake(const char* fontFile, const std::vector<int>& sizes) {
+        faces.clear();
+        std::vector<TTF_Font*> fonts;
+        int x = 0, y = 0, rowHeight = 0;
+        // Shelf-pack every glyph of every size to find the atlas height.
+        for (int size : sizes) {
+            TTF_Font* font = TTF_OpenFont(fontFile, size);
+            if (!font) {
+                LOG_ERROR("Failed to load font: {}", TTF_GetError());
+                for (TTF_Font* f : fonts) {
+                    TTF_CloseFont(f);
+                }
+                return nullptr;
+            }
+            fonts.push_back(font);
+            faces.push_back(AtlasFace());
+            AtlasFace& face = faces.back();
+            face.size = size;
+            face.lineHeight = TTF_FontLineSkip(font);
+            for (int c = ATLAS_FIRST_CHAR; c <= ATLAS_LAST_CHAR; ++c) {
+                int minx, maxx, miny, maxy, advance;
+                TTF_GlyphMetrics32(font, c, &minx, &maxx, &miny, &maxy, &advance);
+                int w = advance, h = TTF_FontHeight(font);
+                if (x + w > ATLAS_WIDTH) {
+                    x = 0;
+                    y += rowHeight + 1;
+                    rowHeight = 0;
+                }
+                face.glyphs[c - ATLAS_FIRST_CHAR] = {{x, y, w, h}, advance};
+                x += w + 1;
+                rowHeight = h > rowHeight ? h : rowHeight;
+            }
+        }
+        width = ATLAS_WIDTH;
+        height = y + rowHeight;
+
+        SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, width, height, 32, SDL_PIXELFORMAT_ARGB8888);
+        SDL_FillRect(atlas, nullptr, SDL_MapRGBA(atlas->format, 255, 255, 255, 0));
+        const SDL_Color white = {255, 255, 255, 255};
+        for (size_t i = 0; i < faces.size(); ++i) {
+            for (int c = ATLAS_FIRST_CHAR; c <= ATLAS_LAST_CHAR; ++c) {
+                SDL_Surface* glyph = TTF_RenderGlyph32_Blended(fonts[i], c, white);
+                if (!glyph) {
+                    continue;
+                }
+                SDL_Rect dst = faces[i].glyphs[c - ATLAS_FIRST_CHAR].src;
+                SDL_Rect clip = {0, 0, dst.w, dst.h};
+                SDL_SetSurfaceBlendMode(glyph, SDL_BLENDMODE_NONE);
+                SDL_BlitSurface(glyph, &clip, atlas, &dst);
+                SDL_FreeSurface(glyph);
+            }
+            TTF_CloseFont(fonts[i]);
+        }
+        return atlas;
+    }
+
+    bool SaveMetrics(const char* metricsFile) const {
+        std::ofstream out(metricsFile);
+        if (!out.is_open()) {
+            return false;
+        }
+        out << "fontatlas 1 " << width << " " << height << " " << faces.size() << "\n";
+        for (const AtlasFace& f : faces) {
+            out << f.size << " " << f.lineHeight << "\n";
+            for (const GlyphInfo& g : f.glyphs) {
+                out << g.src.x << " " << g.src.y << " " << g.src.w << " " << g.src.h << " " << g.advance << "\n";
+            }
+        }
+        return out.good();
+    }
+
+    bool LoadMetrics(const char* metricsFile, const std::vector<int>& sizes) {
+        std::ifstream in(metricsFile);
+        std::string magic;
+        int version = 0;
+        size_t count = 0;
+        if (!(in >> magic >> version >> width >> height >> count) || magic != "fontatlas" || version != 1 || count != sizes.size()) {
+            return false;
+        }
+        faces.assign(count, AtlasFace());
+        for (size_t i = 0; i < count; ++i) {
+            AtlasFace& f = faces[i];
+            if (!(in >> f.size >> f.lineHeight) || f.size != sizes[i]) {
+                faces.clear();
+                return false;
+            }
+            for (GlyphInfo& g : f.glyphs) {
+                in >> g.src.x >> g.src.y >> g.src.w >> g.src.h >> g.advance;
+            }
+        }
+        if (!in) {
+            faces.clear();
+            return false;
+        }
+        return true;
+    }
+};
+
+// Queues text as textured quads and submits them in one SDL_RenderGeometry
+// call per Flush(). The vertex and index buffers keep their capacity between
+// frames, so steady-state text drawing allocates nothing.
+class TextRenderer {
+public:
+    explicit TextRenderer(const FontAtlas& a) : atlas(a) {
+        vertices.reserve(4 * 256);
+        indices.reserve(6 * 256);
+    }
+
+    // Returns the x just past the last glyph.
+    int Draw(const char* text, int x, int y, int size, SDL_Color color) {
+        const AtlasFace* face = atlas.Face(size);
+        if (!face || !atlas.Texture()) {
+            return x;
+        }
+        const float invW = 1.0f / atlas.Width();
+        const float invH = 1.0f / atlas.Height();
+        for (const char* p = text; *p; ++p) {
+            int c = static_cast<unsigned char>(*p);
+            if (c < ATLAS_FIRST_CHAR || c > ATLAS_LAST_CHAR) {
+                c = '?';
+            }
+            const GlyphInfo& g = face->glyphs[c - ATLAS_FIRST_CHAR];
+            if (c != ' ') {
+                int base = static_cast<int>(vertices.size());
+                float x0 = static_cast<float>(x), y0 = static_cast<float>(y);
+                float x1 = x0 + g.src.w, y1 = y0 + g.src.h;
+                float u0 = g.src.x * invW, v0 = g.src.y * invH;
+                float u1 = (g.src.x + g.src.w) * invW, v1 = (g.src.y + g.src.h) * invH;
+                vertices.push_back({{x0, y0}, color, {u0, v0}});
+                vertices.push_back({{x1, y0}, color, {u1, v0}});
+                vertices.push_back({{x1, y1}, color, {u1, v1}});
+                vertices.push_back({{x0, y1}, color, {u0, v1}});
+                const int quad[6] = {0, 1, 2, 0, 2, 3};
+                for (int q : quad) {
+                    indices.push_back(base + q);
+                }
+            }
+            x += g.advance;
+        }
+        return x;
+    }
+
+    int Measure(const char* text, int size) const {
+        const AtlasFace* face = atlas.Face(size);
+        int w = 0;
+        for (const char* p = text; face && *p; ++p) {
+            int c = static_cast<unsigned char>(*p);
+            if (c < ATLAS_FIRST_CHAR || c > ATLAS_LAST_CHAR) {
+                c = '?';
+            }
+            w += face->glyphs[c - ATLAS_FIRST_CHAR].advance;
+        }
+        return w;
+    }
+
+    void Flush(SDL_Renderer* renderer) {
+        if (!indices.empty()) {
+            SDL_RenderGeometry(renderer, atlas.Texture(), vertices.data(), static_cast<int>(vertices.size()),
+                               indices.data(), static_cast<int>(indices.size()));
+        }
+        vertices.clear();
+        indices.clear();
+    }
+
+private:
+    const FontAtlas& atlas;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+#endif
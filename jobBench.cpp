@@ -0,0 +1,73 @@
+#include "jobSystem.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Headless scaling benchmark for jobSystem.h: runs the same entity-update
+// style workload with 1..N threads (the caller counts as one) and reports
+// the speedup over the single-threaded run.
+
+struct Entity {
+    float x, y, vx, vy;
+};
+
+static void updateEntities(vector<Entity>& entities, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; ++i) {
+        Entity& e = entities[i];
+        for (int step = 0; step < 16; ++step) {
+            e.vy += 0.5f;
+            e.x += e.vx;
+            e.y += e.vy;
+            if (e.y > 600.0f) {
+                e.y = 600.0f;
+                e.vy = -e.vy * 0.8f;
+            }
+            e.vx = std::sin(e.x * 0.01f) * 3.0f;
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t entityCount = argc > 1 ? strtoul(argv[1], nullptr, 10) : 2000000;
+    int frames = argc > 2 ? atoi(argv[2]) : 20;
+    unsigned maxThreads = argc > 3 ? atoi(argv[3]) : thread::hardware_concurrency();
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    vector<Entity> entities(entityCount);
+    double baseline = 0;
+    cout << "entities=" << entityCount << " frames=" << frames << endl;
+    cout << "threads\tms/frame\tspeedup" << endl;
+    for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+        for (size_t i = 0; i < entities.size(); ++i) {
+            entities[i] = {static_cast<float>(i % 800), 0.0f, 1.0f, 0.0f};
+        }
+        // The caller helps inside ParallelFor, so N threads means N-1 workers.
+        unique_ptr<JobSystem> jobs;
+        if (threads > 1) {
+            jobs.reset(new JobSystem(threads - 1));
+        }
+        auto start = chrono::steady_clock::now();
+        for (int f = 0; f < frames; ++f) {
+            if (!jobs) {
+                updateEntities(entities, 0, entities.size());
+            } else {
+                jobs->ParallelFor(0, entities.size(), 4096, [&entities](size_t b, size_t e) {
+                    updateEntities(entities, b, e);
+                });
+            }
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() / frames;
+        if (threads == 1) {
+            baseline = ms;
+        }
+        cout << threads << "\t" << ms << "\t" << baseline / ms << endl;
+    }
+    return 0;
+}
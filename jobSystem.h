@@ -0,0 +1,267 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Small work-stealing scheduler. Every worker owns a deque: it pushes and pops
+// at the back, idle workers steal from the front of someone else's deque.
+// Jobs may depend on other jobs and only become runnable once all of their
+// dependencies have finished. The thread calling Wait()/ParallelFor() helps
+// out instead of blocking, so a JobSystem with zero workers still works and
+// simply runs everything on the caller.
+
+class JobSystem;
+
+struct Job {
+    std::function<void()> task;
+    std::atomic<int> pendingDeps;
+    std::atomic<bool> done;
+    std::mutex lock;
+    std::vector<std::shared_ptr<Job>> dependents;
+
+    Job() : pendingDeps(1), done(false) {}
+};
+
+typedef std::shared_ptr<Job> JobHandle;
+
+class JobSystem {
+public:
+    // workerCount == 0 picks one worker per hardware thread minus the caller.
+    explicit JobSystem(unsigned workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    JobHandle Submit(std::function<void()> task);
+    JobHandle Submit(std::function<void()> task, const std::vector<JobHandle>& deps);
+    void Wait(const JobHandle& job);
+    void WaitAll(const std::vector<JobHandle>& jobs);
+
+    // Calls fn(begin, end) over [first, last) split into chunks of at most
+    // grain items. Ranges no larger than one grain run inline on the caller.
+    void ParallelFor(size_t first, size_t last, size_t grain,
+                     const std::function<void(size_t, size_t)>& fn);
+
+    unsigned WorkerCount() const { return static_cast<unsigned>(workers.size()); }
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<JobHandle> jobs;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> stopping;
+    std::atomic<unsigned> nextWorker;
+    std::atomic<int> queued;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+
+    void Enqueue(const JobHandle& job);
+    void Execute(const JobHandle& job);
+    bool PopLocal(int index, JobHandle& out);
+    bool Steal(int thief, JobHandle& out);
+    bool RunOne();
+    void WorkerLoop(int index);
+
+    static int& CurrentWorker();
+};
+
+inline int& JobSystem::CurrentWorker() {
+    static thread_local int index = -1;
+    return index;
+}
+
+inline JobSystem::JobSystem(unsigned workerCount) : stopping(false), nextWorker(0), queued(0) {
+    if (workerCount == 0) {
+        unsigned hw = std::thread::hardware_concurrency();
+        workerCount = hw > 1 ? hw - 1 : 1;
+    }
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers[i]->thread = std::thread(&JobSystem::WorkerLoop, this, static_cast<int>(i));
+    }
+}
+
+inline JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> guard(sleepLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& w : workers) {
+        if (w->thread.joinable()) {
+            w->thread.join();
+        }
+    }
+}
+
+inline JobHandle JobSystem::Submit(std::function<void()> task) {
+    return Submit(std::move(task), std::vector<JobHandle>());
+}
+
+inline JobHandle JobSystem::Submit(std::function<void()> task, const std::vector<JobHandle>& deps) {
+    JobHandle job = std::make_shared<Job>();
+    job->task = std::move(task);
+    for (const JobHandle& dep : deps) {
+        if (!dep) {
+            continue;
+        }
+        std::lock_guard<std::mutex> guard(dep->lock);
+        if (!dep->done) {
+            job->pendingDeps++;
+            dep->dependents.push_back(job);
+        }
+    }
+    // Drop the guard count taken at construction; whoever brings it to zero
+    // (us or the last finishing dependency) makes the job runnable.
+    if (--job->pendingDeps == 0) {
+        Enqueue(job);
+    }
+    return job;
+}
+
+inline void JobSystem::Enqueue(const JobHandle& job) {
+    if (workers.empty()) {
+        Execute(job);
+        return;
+    }
+    int index = CurrentWorker();
+    if (index < 0 || index >= static_cast<int>(workers.size())) {
+        index = static_cast<int>(nextWorker++ % workers.size());
+    }
+    {
+        std::lock_guard<std::mutex> guard(workers[index]->lock);
+        workers[index]->jobs.push_back(job);
+    }
+    queued++;
+    {
+        // Pairs with the predicate check in WorkerLoop so a worker that is
+        // about to sleep cannot miss this wakeup.
+        std::lock_guard<std::mutex> guard(sleepLock);
+    }
+    wake.notify_one();
+}
+
+inline void JobSystem::Execute(const JobHandle& job) {
+    if (job->task) {
+        job->task();
+    }
+    std::vector<JobHandle> ready;
+    {
+        std::lock_guard<std::mutex> guard(job->lock);
+        job->done = true;
+        for (JobHandle& dependent : job->dependents) {
+            if (--dependent->pendingDeps == 0) {
+                ready.push_back(dependent);
+            }
+        }
+        job->dependents.clear();
+    }
+    for (JobHandle& r : ready) {
+        Enqueue(r);
+    }
+}
+
+inline bool JobSystem::PopLocal(int index, JobHandle& out) {
+    Worker& w = *workers[index];
+    std::lock_guard<std::mutex> guard(w.lock);
+    if (w.jobs.empty()) {
+        return false;
+    }
+    out = std::move(w.jobs.back());
+    w.jobs.pop_back();
+    return true;
+}
+
+inline bool JobSystem::Steal(int thief, JobHandle& out) {
+    int count = static_cast<int>(workers.size());
+    int start = thief < 0 ? 0 : thief + 1;
+    for (int i = 0; i < count; ++i) {
+        Worker& victim = *workers[(start + i) % count];
+        std::unique_lock<std::mutex> guard(victim.lock, std::try_to_lock);
+        if (!guard.owns_lock() || victim.jobs.empty()) {
+            continue;
+        }
+        out = std::move(victim.jobs.front());
+        victim.jobs.pop_front();
+        return true;
+    }
+    return false;
+}
+
+inline bool JobSystem::RunOne() {
+    if (workers.empty()) {
+        return false;
+    }
+    int self = CurrentWorker();
+    JobHandle job;
+    if ((self >= 0 && PopLocal(self, job)) || Steal(self, job)) {
+        queued--;
+        Execute(job);
+        return true;
+    }
+    return false;
+}
+
+inline void JobSystem::WorkerLoop(int index) {
+    CurrentWorker() = index;
+    while (!stopping) {
+        if (RunOne()) {
+            continue;
+        }
+        std::unique_lock<std::mutex> guard(sleepLock);
+        wake.wait(guard, [this] { return stopping || queued > 0; });
+    }
+}
+
+inline void JobSystem::Wait(const JobHandle& job) {
+    while (job && !job->done) {
+        if (!RunOne()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline void JobSystem::WaitAll(const std::vector<JobHandle>& jobs) {
+    for (const JobHandle& job : jobs) {
+        Wait(job);
+    }
+}
+
+inline void JobSystem::ParallelFor(size_t first, size_t last, size_t grain,
+                                   const std::function<void(size_t, size_t)>& fn) {
+    if (last <= first) {
+        return;
+    }
+    if (grain == 0) {
+        grain = 1;
+    }
+    if (workers.empty() || last - first <= grain) {
+        fn(first, last);
+        return;
+    }
+    std::vector<JobHandle> chunks;
+    chunks.reserve((last - first) / grain);
+    // The first chunk stays on the caller; the rest go to the workers.
+    for (size_t begin = first + grain; begin < last; begin += grain) {
+        size_t end = begin + grain < last ? begin + grain : last;
+        chunks.push_back(Submit([&fn, begin, end] { fn(begin, end); }));
+    }
+    fn(first, first + grain);
+    WaitAll(chunks);
+}
+
+#endif
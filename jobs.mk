@@ -0,0 +1,2 @@
+jobBench:
+	g++ -O2 -pthread -o jobBench jobBench.cpp
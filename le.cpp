@@ -1,12 +1,57 @@
 #include <iostream>
 #include <SDL2/SDL.h>
+#include <cmath>
 #include <sstream>
 #include <vector>
 #include <fstream>
+#include "autotile.h"
+#include "editHistory.h"
+#include "editJournal.h"
+#include "editTools.h"
+#include "jobSystem.h"
+#include "levelIO.h"
+#include "levelLayers.h"
+#include "liveLink.h"
+#include "tileAtlas.h"
+#include "tileGrid.h"
 using namespace std;
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 const int TILE_SIZE = 32;
+const int VIEW_COLUMNS = SCREEN_WIDTH / TILE_SIZE;
+const int VIEW_ROWS = SCREEN_HEIGHT / TILE_SIZE;
+// Tiles are drawn from the game's atlas over this; transparent parts of
+// the artwork show it too.
+const SDL_Color EMPTY_COLOR = {255, 255, 255, 255};
+const SDL_Color OUTSIDE_COLOR = {96, 96, 96, 255};
+// Palette along the top-left corner, one cell per tile type.
+const int PALETTE_CELL = 40;
+const int PALETTE_GAP = 4;
+const int PANEL_MARGIN = 8;
+// The minimap fits the whole map into this box in the bottom-right corner;
+// large maps are averaged down to at most one texel per screen pixel.
+const int MINIMAP_MAX_WIDTH = 192;
+const int MINIMAP_MAX_HEIGHT = 144;
+const int MINIMAP_MAX_SCALE = 4;
+// Layers other than the one being edited are drawn faded.
+const Uint8 INACTIVE_LAYER_ALPHA = 96;
+// On-screen tile size per zoom level. Below OVERVIEW_TILE_SIZE the map is
+// drawn as one pixel per tile in a streaming texture and scaled instead.
+const double ZOOM_TILE_SIZES[] = {64, 48, 32, 24, 16, 12, 8, 4, 2, 1, 0.5, 0.25, 0.125};
+const int ZOOM_LEVELS = sizeof(ZOOM_TILE_SIZES) / sizeof(ZOOM_TILE_SIZES[0]);
+const int DEFAULT_ZOOM = 2;
+const double OVERVIEW_TILE_SIZE = 8;
+const int MAX_TILE_SIZE = 64;
+const char* const LEVEL_FILE = "level_config.txt";
+const char* const JOURNAL_FILE = "level_config.journal";
+enum EditorTool {
+    TOOL_BRUSH,
+    TOOL_FILL,
+    TOOL_RECT,
+    TOOL_RECT_OUTLINE,
+    TOOL_LINE
+};
+const char* const TOOL_NAMES[] = {"Brush", "Fill", "Rectangle", "Outline", "Line"};
 class LevelEditor {
 public:
     LevelEditor();
@@ -15,145 +60,979 @@ public:
 private:
     SDL_Window* window;
     SDL_Renderer* renderer;
-    vector<vector<int>> levelData;
+    // Every layer is edited through flat indices (layer, y, x) in history,
+    // the journal and ApplyRun; the tools only ever touch activeLayer.
+    Level level;
+    int activeLayer;
+    // Ground variants per layer, updated with the same 3x3 pass the game
+    // uses; cells whose variant changes are marked dirty with the edit.
+    Autotiler autotile[LAYER_COUNT];
     bool isRunning;
     int selectedTile;
+    EditorTool tool;
+    // Rectangle and line tools apply on release, from the press position.
+    bool dragging;
+    int dragStartX, dragStartY;
+    // Brush drags: motion events drained in one HandleInput pass are
+    // collected here and painted as one polyline from the last painted tile.
+    bool painting;
+    int lastPaintX, lastPaintY;
+    vector<SDL_Point> strokePath;
+    // Camera: camX/camY is the map position (in tiles) at the top-left of
+    // the window. Only tiles in [firstCol, firstCol + viewCols) x [firstRow,
+    // firstRow + viewRows) are ever drawn.
+    int zoomLevel;
+    double camX, camY;
+    bool panning;
+    bool cameraMoved;
+    int firstCol, firstRow, viewCols, viewRows;
+    // The tiles in view are drawn once into canvas and afterwards only the
+    // cells in dirtyCells are redrawn; the grid lines live in their own
+    // texture that is baked once per zoom level and laid over the canvas.
+    // At overview zoom levels the visible tiles are streamed into overview
+    // instead, one pixel each.
+    SDL_Texture* canvas;
+    SDL_Texture* gridOverlay;
+    SDL_Texture* overview;
+    int overviewWidth, overviewHeight;
+    int maxTextureWidth, maxTextureHeight;
+    bool overviewDirty;
+    vector<int> dirtyCells;
+    vector<bool> dirtyFlags;
+    bool fullRedraw;
+    bool needsPresent;
+    // Tile artwork shared with the game, and per-type colours derived from
+    // it (ARGB8888, composited over EMPTY_COLOR) for the zoomed-out views.
+    TileAtlas atlas;
+    Uint32 tileColors[TILE_TYPES];
+    // The minimap keeps its pixels here as well as in the texture, so an
+    // edit only recomputes the texels it touched and uploads their bounding
+    // box. Each texel averages a minimapStride x minimapStride block.
+    SDL_Texture* minimap;
+    int minimapWidth, minimapHeight, minimapStride;
+    vector<Uint32> minimapPixels;
+    vector<int> minimapDirty;
+    vector<bool> minimapDirtyFlags;
+    bool minimapVisible;
+    EditHistory history;
+    // Every edit is journaled until a save completes. Saves run on the job
+    // system from a copy-on-write snapshot and report back with a
+    // saveDoneEvent. The snapshot is only ever created and released here on
+    // the main thread, so TileGrid::Set() never sees its row counts change
+    // underneath it.
+    EditJournal journal;
+    JobSystem jobs;
+    JobHandle saveJob;
+    shared_ptr<const Level> saveSnapshot;
+    Uint32 saveDoneEvent;
+    bool saving;
+    bool saveQueued;
+    bool unsaved;
+    // Every grid change is also published to a running game.
+    LiveLinkWriter liveLink;
     void HandleInput();
+    void HandleEvent(const SDL_Event& event);
+    void MarkDirty(int x, int y);
+    void MarkMinimap(int x, int y);
+    void RebuildAutotile();
+    void UpdateAutotile(int layer, int x, int y);
+    int MapWidth() const { return level.Width(); }
+    int MapHeight() const { return level.Height(); }
+    int FlatIndex(int layer, int x, int y) const { return (layer * MapHeight() + y) * MapWidth() + x; }
+    int VisibleTile(int x, int y) const;
+    void SetTile(int x, int y, int type);
+    void EndStroke();
+    void UndoRedo(bool redo);
+    void SetSpan(int y, int xFirst, int xLast, int type);
+    bool ScreenToTile(int screenX, int screenY, int& tileX, int& tileY) const;
+    void BeginTool(int x, int y);
+    void EndTool(int x, int y);
+    void FlushStroke();
+    void SelectTool(EditorTool t);
+    void SelectTile(int type);
+    void SelectLayer(int layer);
+    void UpdateTitle();
+    void ApplyRun(int start, int length, int type);
+    double TileSize() const { return ZOOM_TILE_SIZES[zoomLevel]; }
+    bool IsOverview() const { return TileSize() < OVERVIEW_TILE_SIZE; }
+    void PanBy(double screenDX, double screenDY);
+    void ZoomAt(int screenX, int screenY, int levels);
+    void ResetCamera();
+    void UpdateView();
+    bool CreateTextures();
+    void CreateZoomTextures();
+    void BakeGrid();
+    void DrawCells();
+    void DrawOverview();
+    void CreateMinimap();
+    void UpdateMinimap();
+    SDL_Rect PaletteRect(int type) const;
+    SDL_Rect MinimapRect() const;
+    bool PaletteAt(int screenX, int screenY, int& type) const;
+    bool MinimapAt(int screenX, int screenY);
+    void DrawPalette();
+    void DrawMinimap();
     void Render();
     void SaveConfiguration();
+    void SaveFinished(bool ok);
     void loadConfig(const std::string &);
+    void RecoverJournal();
 };
-LevelEditor::LevelEditor() : window(nullptr), renderer(nullptr), isRunning(true), selectedTile(1) {
-    levelData.resize(SCREEN_HEIGHT / TILE_SIZE, vector<int>(SCREEN_WIDTH / TILE_SIZE, 0));
+LevelEditor::LevelEditor() : window(nullptr), renderer(nullptr), activeLayer(LAYER_COLLISION), isRunning(true), selectedTile(1), tool(TOOL_BRUSH), dragging(false), dragStartX(0), dragStartY(0), painting(false), lastPaintX(0), lastPaintY(0), zoomLevel(DEFAULT_ZOOM), camX(0), camY(0), panning(false), cameraMoved(false), firstCol(0), firstRow(0), viewCols(0), viewRows(0), canvas(nullptr), gridOverlay(nullptr), overview(nullptr), overviewWidth(0), overviewHeight(0), maxTextureWidth(4096), maxTextureHeight(4096), overviewDirty(true), fullRedraw(true), needsPresent(true), minimap(nullptr), minimapWidth(0), minimapHeight(0), minimapStride(1), minimapVisible(true), jobs(1), saveDoneEvent(0), saving(false), saveQueued(false), unsaved(false) {
+    for (TileGrid& grid : level.layers) {
+        grid = TileGrid(VIEW_COLUMNS, VIEW_ROWS);
+    }
+    RebuildAutotile();
 }
 LevelEditor::~LevelEditor() {
+    if (saveJob) {
+        jobs.Wait(saveJob);
+    }
+    if (canvas) {
+        SDL_DestroyTexture(canvas);
+    }
+    if (gridOverlay) {
+        SDL_DestroyTexture(gridOverlay);
+    }
+    if (overview) {
+        SDL_DestroyTexture(overview);
+    }
+    if (minimap) {
+        SDL_DestroyTexture(minimap);
+    }
+    atlas.Destroy();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
+    IMG_Quit();
     SDL_Quit();
 }
+// Sleeps until something happens, then handles everything that is queued.
 void LevelEditor::HandleInput() {
     SDL_Event event;
+    if (!SDL_WaitEvent(&event)) {
+        return;
+    }
+    HandleEvent(event);
     while (SDL_PollEvent(&event) != 0) {
-        if (event.type == SDL_QUIT) {
-            isRunning = false;
-        } else if (event.type == SDL_KEYDOWN) {
-            switch (event.key.keysym.sym) {
-                case SDLK_ESCAPE:
-                    isRunning = false;
-                    break;
-                case SDLK_0:
-                    selectedTile = 0;
-                    break;
-                case SDLK_1:
-                    selectedTile = 1;
-                    break;
-                case SDLK_2:
-                    selectedTile = 2;
-                    break;
-                case SDLK_3:
-                    selectedTile = 3;
-                    break;
-                case SDLK_4:
-                    selectedTile = 4;
-                    break;
-                case SDLK_5:
-                    selectedTile = 5;
-                    break;
-                case SDLK_s:
-                    if (SDL_GetModState() & KMOD_CTRL) {
-                        SaveConfiguration();
-                    }
-                    break;
+        HandleEvent(event);
+    }
+    FlushStroke();
+    if (cameraMoved) {
+        UpdateView();
+    }
+}
+void LevelEditor::HandleEvent(const SDL_Event& event) {
+    if (event.type == SDL_QUIT) {
+        isRunning = false;
+    } else if (saveDoneEvent != 0 && event.type == saveDoneEvent) {
+        SaveFinished(event.user.code != 0);
+    } else if (event.type == SDL_KEYDOWN) {
+        switch (event.key.keysym.sym) {
+            case SDLK_ESCAPE:
+                isRunning = false;
+                break;
+            case SDLK_0:
+                SelectTile(0);
+                break;
+            case SDLK_1:
+                SelectTile(1);
+                break;
+            case SDLK_2:
+                SelectTile(2);
+                break;
+            case SDLK_3:
+                SelectTile(3);
+                break;
+            case SDLK_4:
+                SelectTile(4);
+                break;
+            case SDLK_5:
+                SelectTile(5);
+                break;
+            case SDLK_b:
+                SelectTool(TOOL_BRUSH);
+                break;
+            case SDLK_f:
+                SelectTool(TOOL_FILL);
+                break;
+            case SDLK_r:
+                SelectTool(TOOL_RECT);
+                break;
+            case SDLK_o:
+                SelectTool(TOOL_RECT_OUTLINE);
+                break;
+            case SDLK_l:
+                SelectTool(TOOL_LINE);
+                break;
+            case SDLK_m:
+                minimapVisible = !minimapVisible;
+                needsPresent = true;
+                break;
+            case SDLK_TAB: {
+                // Cycles in drawing order, backwards with Shift.
+                int step = (SDL_GetModState() & KMOD_SHIFT) ? LAYER_COUNT - 1 : 1;
+                int position = 0;
+                while (LAYER_DRAW_ORDER[position] != activeLayer) {
+                    ++position;
+                }
+                SelectLayer(LAYER_DRAW_ORDER[(position + step) % LAYER_COUNT]);
+                break;
             }
-        } else if (event.type == SDL_MOUSEBUTTONDOWN) {
-            if (event.button.button == SDL_BUTTON_LEFT) {
-                int mouseX = event.button.x / TILE_SIZE;
-                int mouseY = event.button.y / TILE_SIZE;
-
-                if (mouseX >= 0 && mouseX < levelData[0].size() && mouseY >= 0 && mouseY < levelData.size()) {
-                    levelData[mouseY][mouseX] = selectedTile;
+            case SDLK_F1:
+            case SDLK_F2:
+            case SDLK_F3:
+            case SDLK_F4:
+                SelectLayer(LAYER_DRAW_ORDER[event.key.keysym.sym - SDLK_F1]);
+                break;
+            case SDLK_LEFT:
+                PanBy(-SCREEN_WIDTH / 4.0, 0);
+                break;
+            case SDLK_RIGHT:
+                PanBy(SCREEN_WIDTH / 4.0, 0);
+                break;
+            case SDLK_UP:
+                PanBy(0, -SCREEN_HEIGHT / 4.0);
+                break;
+            case SDLK_DOWN:
+                PanBy(0, SCREEN_HEIGHT / 4.0);
+                break;
+            case SDLK_EQUALS:
+            case SDLK_KP_PLUS:
+                ZoomAt(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, -1);
+                break;
+            case SDLK_MINUS:
+            case SDLK_KP_MINUS:
+                ZoomAt(SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, 1);
+                break;
+            case SDLK_HOME:
+                ResetCamera();
+                break;
+            case SDLK_s:
+                if (SDL_GetModState() & KMOD_CTRL) {
+                    SaveConfiguration();
+                }
+                break;
+            case SDLK_z:
+                if ((SDL_GetModState() & KMOD_CTRL) && !painting) {
+                    UndoRedo((SDL_GetModState() & KMOD_SHIFT) != 0);
                 }
+                break;
+            case SDLK_y:
+                if ((SDL_GetModState() & KMOD_CTRL) && !painting) {
+                    UndoRedo(true);
+                }
+                break;
+        }
+    } else if (event.type == SDL_MOUSEBUTTONDOWN) {
+        int mouseX, mouseY, type;
+        if (event.button.button == SDL_BUTTON_LEFT && PaletteAt(event.button.x, event.button.y, type)) {
+            SelectTile(type);
+        } else if (event.button.button == SDL_BUTTON_LEFT && MinimapAt(event.button.x, event.button.y)) {
+            // Handled: the camera jumped there.
+        } else if (event.button.button == SDL_BUTTON_LEFT && ScreenToTile(event.button.x, event.button.y, mouseX, mouseY)) {
+            BeginTool(mouseX, mouseY);
+        } else if (event.button.button == SDL_BUTTON_MIDDLE || event.button.button == SDL_BUTTON_RIGHT) {
+            panning = true;
+        }
+    } else if (event.type == SDL_MOUSEWHEEL) {
+        int mouseX, mouseY;
+        SDL_GetMouseState(&mouseX, &mouseY);
+        if (event.wheel.y != 0) {
+            ZoomAt(mouseX, mouseY, event.wheel.y > 0 ? -1 : 1);
+        }
+    } else if (event.type == SDL_MOUSEMOTION) {
+        if (panning) {
+            PanBy(-event.motion.xrel, -event.motion.yrel);
+        }
+        if (painting && !(event.motion.state & SDL_BUTTON_LMASK)) {
+            // The release happened outside the window.
+            FlushStroke();
+            painting = false;
+            EndStroke();
+        } else if (painting) {
+            int tileX, tileY;
+            ScreenToTile(event.motion.x, event.motion.y, tileX, tileY);
+            const SDL_Point& last = strokePath.empty() ? SDL_Point{lastPaintX, lastPaintY} : strokePath.back();
+            if (tileX != last.x || tileY != last.y) {
+                strokePath.push_back({tileX, tileY});
             }
         }
+    } else if (event.type == SDL_MOUSEBUTTONUP) {
+        if (event.button.button == SDL_BUTTON_MIDDLE || event.button.button == SDL_BUTTON_RIGHT) {
+            panning = false;
+        } else if (event.button.button == SDL_BUTTON_LEFT && painting) {
+            FlushStroke();
+            painting = false;
+            EndStroke();
+        } else if (event.button.button == SDL_BUTTON_LEFT && dragging) {
+            // Releasing outside the map still ends the drag, clamped to it.
+            int mouseX, mouseY;
+            ScreenToTile(event.button.x, event.button.y, mouseX, mouseY);
+            EndTool(mouseX, mouseY);
+        }
+    } else if (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+        needsPresent = true;
+    } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+        // Texture contents are gone; rebuild and redraw everything.
+        if (event.type == SDL_RENDER_DEVICE_RESET) {
+            CreateTextures();
+        } else {
+            CreateZoomTextures();
+        }
     }
 }
-void LevelEditor::Render() {
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+// Edits outside the view are not drawn until the camera brings them in.
+void LevelEditor::MarkDirty(int x, int y) {
+    MarkMinimap(x, y);
+    if (cameraMoved) {
+        // UpdateView() is about to redraw the whole view anyway.
+        return;
+    }
+    x -= firstCol;
+    y -= firstRow;
+    if (x < 0 || x >= viewCols || y < 0 || y >= viewRows) {
+        return;
+    }
+    if (IsOverview()) {
+        overviewDirty = true;
+        return;
+    }
+    int cell = y * viewCols + x;
+    if (!dirtyFlags[cell]) {
+        dirtyFlags[cell] = true;
+        dirtyCells.push_back(cell);
+    }
+}
+void LevelEditor::MarkMinimap(int x, int y) {
+    if (minimapPixels.empty()) {
+        return;
+    }
+    int texel = (y / minimapStride) * minimapWidth + x / minimapStride;
+    if (!minimapDirtyFlags[texel]) {
+        minimapDirtyFlags[texel] = true;
+        minimapDirty.push_back(texel);
+    }
+}
+void LevelEditor::RebuildAutotile() {
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        autotile[layer].Build(level.layers[layer]);
+    }
+}
+// Marks the edited cell, and any neighbour whose variant it changed, for
+// redraw.
+void LevelEditor::UpdateAutotile(int layer, int x, int y) {
+    autotile[layer].Update(level.layers[layer], x, y, [this](int cx, int cy) { MarkDirty(cx, cy); });
+}
+// The single way edits reach the grid: records the change for undo and
+// marks the cell for redraw.
+void LevelEditor::SetTile(int x, int y, int type) {
+    TileGrid& grid = level.layers[activeLayer];
+    if (!grid.Contains(x, y) || grid.Get(x, y) == type) {
+        return;
+    }
+    history.Record(FlatIndex(activeLayer, x, y), grid.Get(x, y), type);
+    grid.Set(x, y, type);
+    liveLink.Publish(activeLayer, x, y, type);
+    UpdateAutotile(activeLayer, x, y);
+}
+// Closes the history stroke and journals what it changed.
+void LevelEditor::EndStroke() {
+    if (!history.EndStroke()) {
+        return;
+    }
+    for (const EditHistory::Run& run : history.LastRuns()) {
+        journal.Add(run.start, run.length, run.newValue);
+    }
+    journal.Commit();
+    unsaved = true;
+}
+void LevelEditor::UndoRedo(bool redo) {
+    auto apply = [this](int start, int length, int type) {
+        ApplyRun(start, length, type);
+        journal.Add(start, length, type);
+    };
+    if (redo ? history.Redo(apply) : history.Undo(apply)) {
+        journal.Commit();
+        unsaved = true;
+    }
+}
+void LevelEditor::SetSpan(int y, int xFirst, int xLast, int type) {
+    for (int x = xFirst; x <= xLast; ++x) {
+        SetTile(x, y, type);
+    }
+}
+bool LevelEditor::ScreenToTile(int screenX, int screenY, int& tileX, int& tileY) const {
+    tileX = static_cast<int>(floor(camX + screenX / TileSize()));
+    tileY = static_cast<int>(floor(camY + screenY / TileSize()));
+    return level.Contains(tileX, tileY);
+}
+// Fill applies on press, the brush paints until the release and the shape
+// tools wait for the release.
+void LevelEditor::BeginTool(int x, int y) {
+    if (tool == TOOL_BRUSH) {
+        // The whole drag is one undo stroke, closed on release.
+        history.BeginStroke();
+        SetTile(x, y, selectedTile);
+        painting = true;
+        lastPaintX = x;
+        lastPaintY = y;
+        strokePath.clear();
+        return;
+    }
+    if (tool == TOOL_FILL) {
+        history.BeginStroke();
+        ScanlineFill(x, y, MapWidth(), MapHeight(), selectedTile,
+                     [this](int fx, int fy) { return level.layers[activeLayer].Get(fx, fy); },
+                     [this](int fy, int first, int last) { SetSpan(fy, first, last, selectedTile); });
+        EndStroke();
+        return;
+    }
+    dragging = true;
+    dragStartX = x;
+    dragStartY = y;
+}
+void LevelEditor::EndTool(int x, int y) {
+    dragging = false;
+    int width = MapWidth(), height = MapHeight();
+    x = x < 0 ? 0 : (x >= width ? width - 1 : x);
+    y = y < 0 ? 0 : (y >= height ? height - 1 : y);
+    auto plot = [this](int px, int py) { SetTile(px, py, selectedTile); };
+    history.BeginStroke();
+    if (tool == TOOL_RECT) {
+        RectFill(dragStartX, dragStartY, x, y, width, height,
+                 [this](int fy, int first, int last) { SetSpan(fy, first, last, selectedTile); });
+    } else if (tool == TOOL_RECT_OUTLINE) {
+        RectOutline(dragStartX, dragStartY, x, y, plot);
+    } else if (tool == TOOL_LINE) {
+        BresenhamLine(dragStartX, dragStartY, x, y, plot);
+    }
+    EndStroke();
+}
+void LevelEditor::FlushStroke() {
+    for (const SDL_Point& p : strokePath) {
+        BresenhamLine(lastPaintX, lastPaintY, p.x, p.y, [this](int px, int py) { SetTile(px, py, selectedTile); });
+        lastPaintX = p.x;
+        lastPaintY = p.y;
+    }
+    strokePath.clear();
+}
+void LevelEditor::SelectTool(EditorTool t) {
+    if (painting) {
+        FlushStroke();
+        painting = false;
+        EndStroke();
+    }
+    tool = t;
+    dragging = false;
+    UpdateTitle();
+}
+void LevelEditor::SelectTile(int type) {
+    selectedTile = type;
+    needsPresent = true;
+    UpdateTitle();
+}
+// Other layers stay visible but faded, so the canvas is redrawn.
+void LevelEditor::SelectLayer(int layer) {
+    if (painting) {
+        FlushStroke();
+        painting = false;
+        EndStroke();
+    }
+    dragging = false;
+    activeLayer = layer;
+    fullRedraw = true;
+    needsPresent = true;
+    UpdateTitle();
+}
+// The topmost tile with artwork, for the one-colour-per-tile views.
+int LevelEditor::VisibleTile(int x, int y) const {
+    for (int i = LAYER_COUNT - 1; i >= 0; --i) {
+        int type = level.layers[LAYER_DRAW_ORDER[i]].Get(x, y);
+        if (TileAtlas::HasArt(type)) {
+            return type;
+        }
+    }
+    return TILE_EMPTY;
+}
+void LevelEditor::UpdateTitle() {
+    string title = string("Level Editor - ") + LAYER_NAMES[activeLayer] + " - " + TOOL_NAMES[tool] + " - tile " + to_string(selectedTile);
+    if (saving) {
+        title += " - saving...";
+    } else if (unsaved) {
+        title += " *";
+    }
+    SDL_SetWindowTitle(window, title.c_str());
+}
+// Undo/redo and journal replay path; bypasses the history.
+void LevelEditor::ApplyRun(int start, int length, int type) {
+    int width = MapWidth(), layerSize = width * MapHeight();
+    int end = min(start + length, layerSize * LAYER_COUNT);
+    for (int index = max(start, 0); index < end; ++index) {
+        int layer = index / layerSize, x = index % layerSize % width, y = index % layerSize / width;
+        level.layers[layer].Set(x, y, type);
+        liveLink.Publish(layer, x, y, type);
+        UpdateAutotile(layer, x, y);
+    }
+}
+void LevelEditor::PanBy(double screenDX, double screenDY) {
+    double ts = TileSize();
+    // Keep at least half a screen of map in view.
+    double halfW = SCREEN_WIDTH / ts / 2, halfH = SCREEN_HEIGHT / ts / 2;
+    camX = fmin(fmax(camX + screenDX / ts, -halfW), MapWidth() - halfW);
+    camY = fmin(fmax(camY + screenDY / ts, -halfH), MapHeight() - halfH);
+    cameraMoved = true;
+}
+// Zooms by levels steps (negative zooms in), keeping the tile under the
+// given screen position in place.
+void LevelEditor::ZoomAt(int screenX, int screenY, int levels) {
+    int level = zoomLevel + levels;
+    level = level < 0 ? 0 : (level >= ZOOM_LEVELS ? ZOOM_LEVELS - 1 : level);
+    if (level == zoomLevel) {
+        return;
+    }
+    double tileX = camX + screenX / TileSize(), tileY = camY + screenY / TileSize();
+    zoomLevel = level;
+    camX = tileX - screenX / TileSize();
+    camY = tileY - screenY / TileSize();
+    CreateZoomTextures();
+    PanBy(0, 0);
+}
+void LevelEditor::ResetCamera() {
+    zoomLevel = DEFAULT_ZOOM;
+    camX = camY = 0;
+    CreateZoomTextures();
+    cameraMoved = true;
+}
+// Recomputes the visible tile range after the camera moved; everything in
+// view has to be drawn again.
+void LevelEditor::UpdateView() {
+    double ts = TileSize();
+    int width = MapWidth(), height = MapHeight();
+    firstCol = max(0, static_cast<int>(floor(camX)));
+    firstRow = max(0, static_cast<int>(floor(camY)));
+    int lastCol = min(width - 1, static_cast<int>(floor(camX + SCREEN_WIDTH / ts)));
+    int lastRow = min(height - 1, static_cast<int>(floor(camY + SCREEN_HEIGHT / ts)));
+    viewCols = max(0, lastCol - firstCol + 1);
+    viewRows = max(0, lastRow - firstRow + 1);
+    if (IsOverview()) {
+        viewCols = min(viewCols, overviewWidth);
+        viewRows = min(viewRows, overviewHeight);
+        overviewDirty = true;
+    } else {
+        dirtyFlags.assign(viewCols * viewRows, false);
+        dirtyCells.clear();
+        fullRedraw = true;
+    }
+    cameraMoved = false;
+    needsPresent = true;
+}
+bool LevelEditor::CreateTextures() {
+    if (canvas) {
+        SDL_DestroyTexture(canvas);
+    }
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0 && info.max_texture_width > 0) {
+        maxTextureWidth = info.max_texture_width;
+        maxTextureHeight = info.max_texture_height;
+    }
+    canvas = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+    if (!canvas) {
+        cerr << "Error: Could not create editor textures: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    // A missing image only leaves its tiles blank, as in the game.
+    atlas.Load(renderer);
+    for (int type = 0; type < TILE_TYPES; ++type) {
+        SDL_Color c = atlas.AverageColor(type);
+        auto over = [&c](Uint8 top, Uint8 below) { return static_cast<Uint32>((top * c.a + below * (255 - c.a)) / 255); };
+        tileColors[type] = 0xFF000000u | (over(c.r, EMPTY_COLOR.r) << 16) | (over(c.g, EMPTY_COLOR.g) << 8) | over(c.b, EMPTY_COLOR.b);
+    }
+    CreateZoomTextures();
+    CreateMinimap();
+    return true;
+}
+// The grid depends on the tile size and the overview texture on how many
+// tiles fit on screen, so both are rebuilt when the zoom changes.
+void LevelEditor::CreateZoomTextures() {
+    if (gridOverlay) {
+        SDL_DestroyTexture(gridOverlay);
+        gridOverlay = nullptr;
+    }
+    if (overview) {
+        SDL_DestroyTexture(overview);
+        overview = nullptr;
+    }
+    overviewWidth = overviewHeight = 0;
+    if (IsOverview()) {
+        overviewWidth = min(min(MapWidth(), static_cast<int>(SCREEN_WIDTH / TileSize()) + 2), maxTextureWidth);
+        overviewHeight = min(min(MapHeight(), static_cast<int>(SCREEN_HEIGHT / TileSize()) + 2), maxTextureHeight);
+        if (overviewWidth > 0 && overviewHeight > 0) {
+            overview = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, overviewWidth, overviewHeight);
+        }
+        overviewDirty = true;
+    } else {
+        gridOverlay = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                        SCREEN_WIDTH + MAX_TILE_SIZE, SCREEN_HEIGHT + MAX_TILE_SIZE);
+        if (gridOverlay) {
+            SDL_SetTextureBlendMode(gridOverlay, SDL_BLENDMODE_BLEND);
+            BakeGrid();
+        }
+        fullRedraw = true;
+    }
+    cameraMoved = true;
+}
+void LevelEditor::BakeGrid() {
+    if (!gridOverlay) {
+        return;
+    }
+    int ts = static_cast<int>(TileSize());
+    vector<SDL_Rect> cells;
+    for (int y = 0; y < SCREEN_HEIGHT + MAX_TILE_SIZE; y += ts) {
+        for (int x = 0; x < SCREEN_WIDTH + MAX_TILE_SIZE; x += ts) {
+            cells.push_back({x, y, ts, ts});
+        }
+    }
+    SDL_SetRenderTarget(renderer, gridOverlay);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
     SDL_RenderClear(renderer);
-    for (int y = 0; y < levelData.size(); ++y) {
-        for (int x = 0; x < levelData[y].size(); ++x) {
-            int tileValue = levelData[y][x];
-            SDL_Rect tileRect = {(x * TILE_SIZE), (y * TILE_SIZE), TILE_SIZE, TILE_SIZE};
-            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-            SDL_RenderDrawRect(renderer, &tileRect);
-            if (tileValue == 0) {
-                continue;
-            } else if (tileValue == 1) {
-                SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
-                SDL_RenderFillRect(renderer, &tileRect);
-            } else if (tileValue == 2) {
-                SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
-                SDL_RenderFillRect(renderer, &tileRect);
-            } else if (tileValue == 3) {
-                SDL_SetRenderDrawColor(renderer, 0, 0, 255, 255);
-                SDL_RenderFillRect(renderer, &tileRect);
-            } else if (tileValue == 4) {
-                SDL_SetRenderDrawColor(renderer, 0, 0, 150, 255);
-                SDL_RenderFillRect(renderer, &tileRect);
-            } else if (tileValue == 5) {
-                SDL_SetRenderDrawColor(renderer,0,255,255,255);
-                SDL_RenderFillRect(renderer,&tileRect);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderDrawRects(renderer, cells.data(), static_cast<int>(cells.size()));
+    SDL_SetRenderTarget(renderer, nullptr);
+}
+// Redraws the dirty cells (or every cell in view) into the canvas: one
+// SDL_RenderFillRects call for the background, then the tile artwork.
+void LevelEditor::DrawCells() {
+    if (!fullRedraw && dirtyCells.empty()) {
+        return;
+    }
+    int ts = static_cast<int>(TileSize());
+    int originX = static_cast<int>(lround(camX * ts)), originY = static_cast<int>(lround(camY * ts));
+    SDL_SetRenderTarget(renderer, canvas);
+    if (fullRedraw) {
+        SDL_SetRenderDrawColor(renderer, OUTSIDE_COLOR.r, OUTSIDE_COLOR.g, OUTSIDE_COLOR.b, OUTSIDE_COLOR.a);
+        SDL_RenderClear(renderer);
+        dirtyCells.clear();
+        for (int cell = 0; cell < viewCols * viewRows; ++cell) {
+            dirtyCells.push_back(cell);
+        }
+    }
+    vector<SDL_Rect> background;
+    // Ground tiles are drawn by variant, everything else by type.
+    vector<SDL_Rect> rects[LAYER_COUNT][TILE_TYPES];
+    vector<SDL_Rect> variantRects[LAYER_COUNT][AUTOTILE_VARIANTS];
+    for (int cell : dirtyCells) {
+        int x = firstCol + cell % viewCols, y = firstRow + cell / viewCols;
+        SDL_Rect rect = {x * ts - originX, y * ts - originY, ts, ts};
+        background.push_back(rect);
+        for (int i = 0; i < LAYER_COUNT; ++i) {
+            int layer = LAYER_DRAW_ORDER[i];
+            int tileValue = level.layers[layer].Get(x, y);
+            int variant = autotile[layer].Variant(x, y);
+            if (variant != AUTOTILE_NONE && atlas.HasVariants()) {
+                variantRects[i][variant].push_back(rect);
+            } else if (TileAtlas::HasArt(tileValue)) {
+                rects[i][tileValue].push_back(rect);
             }
-            // Add more cases for different tile values
         }
+        dirtyFlags[cell] = false;
     }
+    dirtyCells.clear();
+    fullRedraw = false;
 
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+    SDL_SetRenderDrawColor(renderer, EMPTY_COLOR.r, EMPTY_COLOR.g, EMPTY_COLOR.b, EMPTY_COLOR.a);
+    SDL_RenderFillRects(renderer, background.data(), static_cast<int>(background.size()));
+    for (int i = 0; i < LAYER_COUNT; ++i) {
+        if (atlas.Texture()) {
+            SDL_SetTextureAlphaMod(atlas.Texture(), LAYER_DRAW_ORDER[i] == activeLayer ? 255 : INACTIVE_LAYER_ALPHA);
+        }
+        for (int type = 0; type < TILE_TYPES; ++type) {
+            for (const SDL_Rect& rect : rects[i][type]) {
+                atlas.Draw(renderer, type, rect);
+            }
+        }
+        for (int variant = 0; variant < AUTOTILE_VARIANTS; ++variant) {
+            for (const SDL_Rect& rect : variantRects[i][variant]) {
+                atlas.DrawVariant(renderer, variant, rect);
+            }
+        }
+    }
+    if (atlas.Texture()) {
+        SDL_SetTextureAlphaMod(atlas.Texture(), 255);
+    }
+    SDL_SetRenderTarget(renderer, nullptr);
+    needsPresent = true;
+}
+// Writes one pixel per visible tile into the streaming overview texture.
+void LevelEditor::DrawOverview() {
+    if (!overviewDirty || !overview || viewCols == 0 || viewRows == 0) {
+        return;
+    }
+    SDL_Rect region = {0, 0, viewCols, viewRows};
+    void* pixels;
+    int pitch;
+    if (SDL_LockTexture(overview, &region, &pixels, &pitch) != 0) {
+        return;
+    }
+    for (int y = 0; y < viewRows; ++y) {
+        Uint32* row = reinterpret_cast<Uint32*>(static_cast<Uint8*>(pixels) + y * pitch);
+        for (int x = 0; x < viewCols; ++x) {
+            row[x] = tileColors[VisibleTile(firstCol + x, firstRow + y)];
+        }
+    }
+    SDL_UnlockTexture(overview);
+    overviewDirty = false;
+    needsPresent = true;
+}
+// One texel per minimapStride x minimapStride block of tiles, so the
+// minimap never needs more texels than screen pixels.
+void LevelEditor::CreateMinimap() {
+    if (minimap) {
+        SDL_DestroyTexture(minimap);
+        minimap = nullptr;
+    }
+    minimapPixels.clear();
+    minimapDirty.clear();
+    int width = MapWidth(), height = MapHeight();
+    if (width == 0 || height == 0) {
+        return;
+    }
+    minimapStride = max(max((width + MINIMAP_MAX_WIDTH - 1) / MINIMAP_MAX_WIDTH, (height + MINIMAP_MAX_HEIGHT - 1) / MINIMAP_MAX_HEIGHT), 1);
+    minimapWidth = (width + minimapStride - 1) / minimapStride;
+    minimapHeight = (height + minimapStride - 1) / minimapStride;
+    minimap = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, minimapWidth, minimapHeight);
+    if (!minimap) {
+        return;
+    }
+    minimapPixels.assign(minimapWidth * minimapHeight, 0);
+    minimapDirtyFlags.assign(minimapPixels.size(), true);
+    for (int texel = 0; texel < static_cast<int>(minimapPixels.size()); ++texel) {
+        minimapDirty.push_back(texel);
+    }
+}
+// Recomputes the texels edited since the last frame and uploads only the
+// rectangle that contains them.
+void LevelEditor::UpdateMinimap() {
+    if (!minimap || minimapDirty.empty()) {
+        return;
+    }
+    int width = MapWidth(), height = MapHeight();
+    int left = minimapWidth, top = minimapHeight, right = -1, bottom = -1;
+    for (int texel : minimapDirty) {
+        int tx = texel % minimapWidth, ty = texel / minimapWidth;
+        int x0 = tx * minimapStride, y0 = ty * minimapStride;
+        int x1 = min(x0 + minimapStride, width), y1 = min(y0 + minimapStride, height);
+        Uint32 r = 0, g = 0, b = 0;
+        for (int y = y0; y < y1; ++y) {
+            for (int x = x0; x < x1; ++x) {
+                Uint32 c = tileColors[VisibleTile(x, y)];
+                r += (c >> 16) & 0xFF;
+                g += (c >> 8) & 0xFF;
+                b += c & 0xFF;
+            }
+        }
+        Uint32 count = (x1 - x0) * (y1 - y0);
+        minimapPixels[texel] = 0xFF000000u | ((r / count) << 16) | ((g / count) << 8) | (b / count);
+        minimapDirtyFlags[texel] = false;
+        left = min(left, tx);
+        right = max(right, tx);
+        top = min(top, ty);
+        bottom = max(bottom, ty);
+    }
+    minimapDirty.clear();
+    SDL_Rect bounds = {left, top, right - left + 1, bottom - top + 1};
+    SDL_UpdateTexture(minimap, &bounds, &minimapPixels[top * minimapWidth + left], minimapWidth * sizeof(Uint32));
+    if (minimapVisible) {
+        needsPresent = true;
+    }
+}
+SDL_Rect LevelEditor::PaletteRect(int type) const {
+    return SDL_Rect{PANEL_MARGIN + type * (PALETTE_CELL + PALETTE_GAP), PANEL_MARGIN, PALETTE_CELL, PALETTE_CELL};
+}
+SDL_Rect LevelEditor::MinimapRect() const {
+    double scale = min(min(static_cast<double>(MINIMAP_MAX_WIDTH) / minimapWidth, static_cast<double>(MINIMAP_MAX_HEIGHT) / minimapHeight),
+                       static_cast<double>(MINIMAP_MAX_SCALE));
+    int w = static_cast<int>(minimapWidth * scale), h = static_cast<int>(minimapHeight * scale);
+    return SDL_Rect{SCREEN_WIDTH - PANEL_MARGIN - w, SCREEN_HEIGHT - PANEL_MARGIN - h, w, h};
+}
+bool LevelEditor::PaletteAt(int screenX, int screenY, int& type) const {
+    SDL_Point p = {screenX, screenY};
+    for (int t = 0; t < TILE_TYPES; ++t) {
+        SDL_Rect rect = PaletteRect(t);
+        if (SDL_PointInRect(&p, &rect)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+// A click on the minimap centres the view on that spot.
+bool LevelEditor::MinimapAt(int screenX, int screenY) {
+    if (!minimapVisible || !minimap) {
+        return false;
+    }
+    SDL_Rect rect = MinimapRect();
+    SDL_Point p = {screenX, screenY};
+    if (!SDL_PointInRect(&p, &rect)) {
+        return false;
+    }
+    double tileX = static_cast<double>(screenX - rect.x) / rect.w * minimapWidth * minimapStride;
+    double tileY = static_cast<double>(screenY - rect.y) / rect.h * minimapHeight * minimapStride;
+    camX = tileX - SCREEN_WIDTH / TileSize() / 2;
+    camY = tileY - SCREEN_HEIGHT / TileSize() / 2;
+    PanBy(0, 0);
+    return true;
+}
+void LevelEditor::DrawPalette() {
+    SDL_Rect panel = {PANEL_MARGIN - PALETTE_GAP, PANEL_MARGIN - PALETTE_GAP,
+                      TILE_TYPES * (PALETTE_CELL + PALETTE_GAP) + PALETTE_GAP, PALETTE_CELL + 2 * PALETTE_GAP};
+    SDL_SetRenderDrawColor(renderer, 40, 40, 40, 255);
+    SDL_RenderFillRect(renderer, &panel);
+    for (int type = 0; type < TILE_TYPES; ++type) {
+        SDL_Rect cell = PaletteRect(type);
+        SDL_SetRenderDrawColor(renderer, EMPTY_COLOR.r, EMPTY_COLOR.g, EMPTY_COLOR.b, EMPTY_COLOR.a);
+        SDL_RenderFillRect(renderer, &cell);
+        atlas.Draw(renderer, type, cell);
+    }
+    SDL_Rect selected = PaletteRect(selectedTile);
+    SDL_Rect frames[2] = {{selected.x - 2, selected.y - 2, selected.w + 4, selected.h + 4},
+                          {selected.x - 1, selected.y - 1, selected.w + 2, selected.h + 2}};
+    SDL_SetRenderDrawColor(renderer, 255, 220, 0, 255);
+    SDL_RenderDrawRects(renderer, frames, 2);
+}
+// The cached minimap plus the outline of what the main view shows.
+void LevelEditor::DrawMinimap() {
+    if (!minimapVisible || !minimap) {
+        return;
+    }
+    SDL_Rect rect = MinimapRect();
+    SDL_Rect frame = {rect.x - 1, rect.y - 1, rect.w + 2, rect.h + 2};
+    SDL_SetRenderDrawColor(renderer, 40, 40, 40, 255);
+    SDL_RenderDrawRect(renderer, &frame);
+    SDL_RenderCopy(renderer, minimap, nullptr, &rect);
+    double scaleX = static_cast<double>(rect.w) / (minimapWidth * minimapStride);
+    double scaleY = static_cast<double>(rect.h) / (minimapHeight * minimapStride);
+    SDL_Rect view = {rect.x + static_cast<int>(floor(camX * scaleX)), rect.y + static_cast<int>(floor(camY * scaleY)),
+                     max(static_cast<int>(SCREEN_WIDTH / TileSize() * scaleX), 2), max(static_cast<int>(SCREEN_HEIGHT / TileSize() * scaleY), 2)};
+    SDL_RenderSetClipRect(renderer, &rect);
+    SDL_SetRenderDrawColor(renderer, 255, 220, 0, 255);
+    SDL_RenderDrawRect(renderer, &view);
+    SDL_RenderSetClipRect(renderer, nullptr);
+}
+void LevelEditor::Render() {
+    if (IsOverview()) {
+        DrawOverview();
+    } else {
+        DrawCells();
+    }
+    UpdateMinimap();
+    if (!needsPresent) {
+        return;
+    }
+    double ts = TileSize();
+    if (IsOverview()) {
+        SDL_SetRenderDrawColor(renderer, OUTSIDE_COLOR.r, OUTSIDE_COLOR.g, OUTSIDE_COLOR.b, OUTSIDE_COLOR.a);
+        SDL_RenderClear(renderer);
+        if (overview && viewCols > 0 && viewRows > 0) {
+            SDL_Rect src = {0, 0, viewCols, viewRows};
+            SDL_FRect dst = {static_cast<float>((firstCol - camX) * ts), static_cast<float>((firstRow - camY) * ts),
+                             static_cast<float>(viewCols * ts), static_cast<float>(viewRows * ts)};
+            SDL_RenderCopyF(renderer, overview, &src, &dst);
+        }
+    } else {
+        int tileSize = static_cast<int>(ts);
+        int originX = static_cast<int>(lround(camX * tileSize)), originY = static_cast<int>(lround(camY * tileSize));
+        SDL_RenderCopy(renderer, canvas, nullptr, nullptr);
+        // Grid only over the map itself.
+        SDL_Rect mapRect = {-originX, -originY, MapWidth() * tileSize, MapHeight() * tileSize};
+        SDL_Rect grid = {-(((originX % tileSize) + tileSize) % tileSize), -(((originY % tileSize) + tileSize) % tileSize),
+                         SCREEN_WIDTH + MAX_TILE_SIZE, SCREEN_HEIGHT + MAX_TILE_SIZE};
+        SDL_RenderSetClipRect(renderer, &mapRect);
+        SDL_RenderCopy(renderer, gridOverlay, nullptr, &grid);
+        SDL_RenderSetClipRect(renderer, nullptr);
+    }
+    DrawPalette();
+    DrawMinimap();
     SDL_RenderPresent(renderer);
+    needsPresent = false;
 }
+// Ctrl+S. The grid is snapshotted here (copying row pointers only) and
+// formatted and written on the job system; a save requested while one is
+// running starts when it finishes.
 void LevelEditor::SaveConfiguration() {
-    fstream outFile;
-    outFile.open("level_config.txt", ios::out);
-    if (!outFile.is_open()) {
-        cerr << "Error: Could not open file for writing." << std::endl;
+    if (saving) {
+        saveQueued = true;
         return;
     }
-
-    for (int y = 0; y < levelData.size(); ++y) {
-        for (int x = 0; x < levelData[y].size(); ++x) {
-            outFile << levelData[y][x] << " ";
-        }
-        outFile << "\n";
+    saving = true;
+    saveQueued = false;
+    unsaved = false;
+    journal.Rotate();
+    saveSnapshot = make_shared<const Level>(level.Snapshot());
+    const Level* snapshot = saveSnapshot.get();
+    Uint32 doneEvent = saveDoneEvent;
+    saveJob = jobs.Submit([snapshot, doneEvent]() {
+        bool ok = WriteFileAtomic(LEVEL_FILE, FormatLevelText(*snapshot));
+        SDL_Event done;
+        SDL_zero(done);
+        done.type = doneEvent;
+        done.user.code = ok ? 1 : 0;
+        SDL_PushEvent(&done);
+    });
+    UpdateTitle();
+}
+void LevelEditor::SaveFinished(bool ok) {
+    saving = false;
+    // The job is done with it; this lets go of the shared rows.
+    saveSnapshot.reset();
+    if (ok) {
+        journal.SaveCompleted();
+        cout << "Configuration saved to " << LEVEL_FILE << std::endl;
+    } else {
+        // The journal keeps the edits, so the next save still includes them.
+        cerr << "Error: Could not save " << LEVEL_FILE << std::endl;
+        unsaved = true;
     }
-
-    outFile.close();
-    cout << "Configuration saved to level_config.txt" << std::endl;
+    if (saveQueued) {
+        SaveConfiguration();
+    }
+    UpdateTitle();
 }
 void LevelEditor::loadConfig(const std::string &configFile) {
-    ifstream inFile(configFile);
-    if (!inFile.is_open()) {
+    if (!ReadLevel(configFile, level)) {
         cerr << "Error: Could not open file for reading." << std::endl;
         return;
     }
-
-    levelData.clear();
-    int tileType;
-    string line;
-    while (getline(inFile, line, '\n')) {
-        vector<int> tileRow;
-        istringstream ss(line);
-        while (ss >> tileType) {
-            tileRow.push_back(tileType);
-        }
-        levelData.push_back(tileRow);
+    history.Clear();
+    RebuildAutotile();
+    cameraMoved = true;
+}
+// Reapplies edits journaled since the last completed save, i.e. the ones a
+// crash would otherwise have lost, and keeps journaling from there.
+void LevelEditor::RecoverJournal() {
+    int records = EditJournal::Recover(JOURNAL_FILE, MapWidth(), MapHeight(), LAYER_COUNT,
+                                       [this](int start, int length, int type) { ApplyRun(start, length, type); });
+    if (records < 0) {
+        // Its flat indices would land on the wrong tiles. Leave it (and its
+        // .prev) alone for the level it belongs to, and do not journal over it.
+        cerr << "Error: " << JOURNAL_FILE << " was written for a level of a different size; it was not replayed, and edits will not be journaled until it is moved away." << std::endl;
+        return;
+    }
+    if (records > 0) {
+        cout << "Recovered " << records << " unsaved edits from " << JOURNAL_FILE << std::endl;
+        unsaved = true;
+    }
+    if (!journal.Open(JOURNAL_FILE, MapWidth(), MapHeight(), LAYER_COUNT)) {
+        cerr << "Error: Could not open " << JOURNAL_FILE << ", edits will not be journaled." << std::endl;
     }
-
-    inFile.close();
 }
 void LevelEditor::Run() {
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         isRunning = false;
         return;
     }
+    IMG_Init(IMG_INIT_PNG);
 
     window = SDL_CreateWindow("Level Editor", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
     if (!window) {
@@ -167,8 +1046,24 @@ void LevelEditor::Run() {
         return;
     }
 
-    loadConfig("level_config.txt");
+    saveDoneEvent = SDL_RegisterEvents(1);
+    if (saveDoneEvent == static_cast<Uint32>(-1)) {
+        saveDoneEvent = 0;
+    }
+    loadConfig(LEVEL_FILE);
+    RecoverJournal();
+    if (!liveLink.Create(MapWidth(), MapHeight(), LAYER_COUNT, [this](int layer, int x, int y) { return level.layers[layer].Get(x, y); })) {
+        cerr << "Live link unavailable, running games will not see edits." << std::endl;
+    }
+    if (!CreateTextures()) {
+        isRunning = false;
+        return;
+    }
+    UpdateView();
+    UpdateTitle();
 
+    // Draw once, then only when an event changed something.
+    Render();
     while (isRunning) {
         HandleInput();
         Render();
@@ -0,0 +1,341 @@
+#ifndef LEVEL_IO_H
+#define LEVEL_IO_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "levelLayers.h"
+#include "tileGrid.h"
+
+#ifdef _WIN32
+#include <io.h>
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+// Reading and writing level files. The text format is the one
+// level_config.txt has always used: one row per line, each tile written as
+// its number followed by a space. Levels with visual layers add a
+// "[layer name]" line before each layer's rows; rows before the first such
+// line belong to the collision layer, so old files read as collision-only
+// levels, and collision-only levels are still written without headers.
+// The binary format is for the content pipeline, all little-endian 32-bit:
+// "LVB1" followed by one grid (width, height, run count, then (length,
+// value) runs in row-major order) for collision-only levels, or "LVB2", a
+// layer count and that many (layer number, grid) pairs.
+
+inline bool ReadLevelText(const std::string& path, Level& level) {
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in) {
+        return false;
+    }
+    Level out;
+    std::vector<std::vector<int>> rows;
+    std::vector<int> row;
+    std::string header;
+    int layer = LAYER_COLLISION;
+    int value = 0;
+    bool inNumber = false, negative = false, inHeader = false;
+    // Sections with unknown names are skipped.
+    auto finishLayer = [&]() {
+        if (layer >= 0) {
+            out.layers[layer] = TileGrid::FromRows(std::move(rows));
+        }
+        rows.clear();
+    };
+    char buffer[64 * 1024];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        for (size_t i = 0; i < got; ++i) {
+            char c = buffer[i];
+            if (inHeader) {
+                if (c == '\n') {
+                    finishLayer();
+                    size_t close = header.find(']');
+                    layer = LayerByName(header.substr(0, close));
+                    header.clear();
+                    inHeader = false;
+                } else if (c != '\r') {
+                    header += c;
+                }
+            } else if (c >= '0' && c <= '9') {
+                value = value * 10 + (c - '0');
+                inNumber = true;
+            } else if (c == '-' && !inNumber) {
+                negative = true;
+            } else if (c == '[' && row.empty() && !inNumber) {
+                inHeader = true;
+            } else {
+                if (inNumber) {
+                    row.push_back(negative ? -value : value);
+                }
+                value = 0;
+                inNumber = negative = false;
+                if (c == '\n') {
+                    rows.push_back(std::move(row));
+                    row.clear();
+                }
+            }
+        }
+    }
+    fclose(in);
+    if (inNumber) {
+        row.push_back(negative ? -value : value);
+    }
+    if (!row.empty()) {
+        rows.push_back(std::move(row));
+    }
+    finishLayer();
+    out.Normalize();
+    level = std::move(out);
+    return true;
+}
+
+inline void AppendGridText(std::string& out, const TileGrid& grid) {
+    out.reserve(out.size() + static_cast<size_t>(grid.Width() + 1) * grid.Height() * 2);
+    char digits[12];
+    for (int y = 0; y < grid.Height(); ++y) {
+        for (int value : grid.Row(y)) {
+            if (value >= 0 && value < 10) {
+                out += static_cast<char>('0' + value);
+            } else {
+                int n = snprintf(digits, sizeof(digits), "%d", value);
+                out.append(digits, n);
+            }
+            out += ' ';
+        }
+        out += '\n';
+    }
+}
+
+// Empty visual layers are left out.
+inline std::string FormatLevelText(const Level& level) {
+    std::string out;
+    if (!level.HasVisualLayers()) {
+        AppendGridText(out, level.Collision());
+        return out;
+    }
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        if (layer == LAYER_COLLISION || !level.layers[layer].AllZero()) {
+            out += '[';
+            out += LAYER_NAMES[layer];
+            out += "]\n";
+            AppendGridText(out, level.layers[layer]);
+        }
+    }
+    return out;
+}
+
+const char LEVEL_BINARY_MAGIC[4] = {'L', 'V', 'B', '1'};
+const char LEVEL_LAYERS_MAGIC[4] = {'L', 'V', 'B', '2'};
+
+inline void PutLittle32(std::string& out, uint32_t v) {
+    char bytes[4] = {static_cast<char>(v), static_cast<char>(v >> 8), static_cast<char>(v >> 16), static_cast<char>(v >> 24)};
+    out.append(bytes, 4);
+}
+
+inline uint32_t GetLittle32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+inline void AppendGridBinary(std::string& out, const TileGrid& grid) {
+    std::string runs;
+    uint32_t count = 0, length = 0;
+    int value = 0;
+    for (int y = 0; y < grid.Height(); ++y) {
+        for (int tile : grid.Row(y)) {
+            if (length > 0 && tile == value) {
+                ++length;
+                continue;
+            }
+            if (length > 0) {
+                PutLittle32(runs, length);
+                PutLittle32(runs, static_cast<uint32_t>(value));
+                ++count;
+            }
+            value = tile;
+            length = 1;
+        }
+    }
+    if (length > 0) {
+        PutLittle32(runs, length);
+        PutLittle32(runs, static_cast<uint32_t>(value));
+        ++count;
+    }
+    PutLittle32(out, static_cast<uint32_t>(grid.Width()));
+    PutLittle32(out, static_cast<uint32_t>(grid.Height()));
+    PutLittle32(out, count);
+    out += runs;
+}
+
+inline std::string FormatLevelBinary(const Level& level) {
+    if (!level.HasVisualLayers()) {
+        std::string out(LEVEL_BINARY_MAGIC, 4);
+        AppendGridBinary(out, level.Collision());
+        return out;
+    }
+    std::string out(LEVEL_LAYERS_MAGIC, 4);
+    uint32_t count = 0;
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        count += layer == LAYER_COLLISION || !level.layers[layer].AllZero() ? 1 : 0;
+    }
+    PutLittle32(out, count);
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        if (layer == LAYER_COLLISION || !level.layers[layer].AllZero()) {
+            PutLittle32(out, static_cast<uint32_t>(layer));
+            AppendGridBinary(out, level.layers[layer]);
+        }
+    }
+    return out;
+}
+
+// Limits on what a binary level may claim to be, checked before anything
+// is allocated for it.
+const uint32_t LEVEL_MAX_SIDE = 1u << 16;
+const uint64_t LEVEL_MAX_TILES = 1u << 26;
+
+// Reads one grid at p and advances p past it. Rejects truncated data and
+// runs that do not cover the grid exactly. The runs are summed before the
+// grid is allocated, so a header claiming a huge grid with no data behind it
+// fails without allocating.
+inline bool ParseGridBinary(const unsigned char*& p, const unsigned char* end, TileGrid& grid) {
+    if (end - p < 12) {
+        return false;
+    }
+    uint32_t width = GetLittle32(p), height = GetLittle32(p + 4), count = GetLittle32(p + 8);
+    uint64_t tiles = static_cast<uint64_t>(width) * height;
+    p += 12;
+    if ((width == 0 && height != 0) || width > LEVEL_MAX_SIDE || height > LEVEL_MAX_SIDE || tiles > LEVEL_MAX_TILES ||
+        static_cast<uint64_t>(end - p) / 8 < count) {
+        return false;
+    }
+    uint64_t covered = 0;
+    for (uint32_t r = 0; r < count; ++r) {
+        covered += GetLittle32(p + 8 * static_cast<size_t>(r));
+    }
+    if (covered != tiles) {
+        return false;
+    }
+    std::vector<std::vector<int>> rows(height, std::vector<int>(width));
+    uint64_t index = 0;
+    for (uint32_t r = 0; r < count; ++r, p += 8) {
+        uint32_t length = GetLittle32(p);
+        int value = static_cast<int32_t>(GetLittle32(p + 4));
+        while (length > 0) {
+            std::vector<int>& row = rows[index / width];
+            uint32_t x = static_cast<uint32_t>(index % width);
+            uint32_t span = width - x < length ? width - x : length;
+            std::fill(row.begin() + x, row.begin() + x + span, value);
+            index += span;
+            length -= span;
+        }
+    }
+    grid = TileGrid::FromRows(std::move(rows));
+    return true;
+}
+
+inline bool ParseLevelBinary(const std::string& data, Level& level) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data.data());
+    const unsigned char* end = p + data.size();
+    if (data.size() < 4) {
+        return false;
+    }
+    Level out;
+    if (memcmp(p, LEVEL_BINARY_MAGIC, 4) == 0) {
+        p += 4;
+        if (!ParseGridBinary(p, end, out.layers[LAYER_COLLISION])) {
+            return false;
+        }
+    } else if (memcmp(p, LEVEL_LAYERS_MAGIC, 4) == 0 && data.size() >= 8) {
+        uint32_t count = GetLittle32(p + 4);
+        p += 8;
+        for (uint32_t i = 0; i < count; ++i) {
+            if (end - p < 4) {
+                return false;
+            }
+            uint32_t layer = GetLittle32(p);
+            p += 4;
+            // Layers this build does not know are parsed and dropped.
+            TileGrid grid;
+            if (!ParseGridBinary(p, end, grid)) {
+                return false;
+            }
+            if (layer < LAYER_COUNT) {
+                out.layers[layer] = std::move(grid);
+            }
+        }
+    } else {
+        return false;
+    }
+    out.Normalize();
+    level = std::move(out);
+    return true;
+}
+
+inline bool ReadFileBytes(const std::string& path, std::string& data) {
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in) {
+        return false;
+    }
+    data.clear();
+    char buffer[64 * 1024];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        data.append(buffer, got);
+    }
+    bool ok = !ferror(in);
+    fclose(in);
+    return ok;
+}
+
+// Either format, told apart by the binary magic.
+inline bool ReadLevel(const std::string& path, Level& level) {
+    FILE* in = fopen(path.c_str(), "rb");
+    if (!in) {
+        return false;
+    }
+    char magic[4] = {};
+    bool binary = fread(magic, 1, 4, in) == 4 &&
+                  (memcmp(magic, LEVEL_BINARY_MAGIC, 4) == 0 || memcmp(magic, LEVEL_LAYERS_MAGIC, 4) == 0);
+    fclose(in);
+    if (!binary) {
+        return ReadLevelText(path, level);
+    }
+    std::string data;
+    return ReadFileBytes(path, data) && ParseLevelBinary(data, level);
+}
+
+// Writes data to path + ".tmp", flushes it to disk and renames it over
+// path, so readers (and a crash) see either the old file or the new one.
+inline bool WriteFileAtomic(const std::string& path, const std::string& data) {
+    std::string temp = path + ".tmp";
+    FILE* out = fopen(temp.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), out) == data.size() && fflush(out) == 0;
+#ifdef _WIN32
+    ok = ok && _commit(_fileno(out)) == 0;
+#else
+    ok = ok && fsync(fileno(out)) == 0;
+#endif
+    ok = fclose(out) == 0 && ok;
+    if (ok) {
+#ifdef _WIN32
+        ok = MoveFileExA(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+        ok = rename(temp.c_str(), path.c_str()) == 0;
+#endif
+    }
+    if (!ok) {
+        remove(temp.c_str());
+    }
+    return ok;
+}
+
+#endif
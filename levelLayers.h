@@ -0,0 +1,88 @@
+#ifndef LEVEL_LAYERS_H
+#define LEVEL_LAYERS_H
+
+#include <string>
+#include "tileGrid.h"
+
+// A level is a stack of equally sized tile layers. Only the collision layer
+// means anything to gameplay (solid tiles, spawn, flag); the others are
+// artwork. Layers are numbered in storage order with collision first, so
+// single-layer level files, edit journals and flat edit indices from before
+// layers existed all still refer to the collision layer. LAYER_DRAW_ORDER
+// is back to front: everything up to decoration is drawn behind the player
+// and the foreground in front of it.
+
+enum LevelLayer {
+    LAYER_COLLISION,
+    LAYER_BACKGROUND,
+    LAYER_DECORATION,
+    LAYER_FOREGROUND,
+    LAYER_COUNT
+};
+
+const char* const LAYER_NAMES[LAYER_COUNT] = {"collision", "background", "decoration", "foreground"};
+const LevelLayer LAYER_DRAW_ORDER[LAYER_COUNT] = {LAYER_BACKGROUND, LAYER_COLLISION, LAYER_DECORATION, LAYER_FOREGROUND};
+
+inline int LayerByName(const std::string& name) {
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        if (name == LAYER_NAMES[layer]) {
+            return layer;
+        }
+    }
+    return -1;
+}
+
+struct Level {
+    TileGrid layers[LAYER_COUNT];
+
+    int Width() const { return layers[LAYER_COLLISION].Width(); }
+    int Height() const { return layers[LAYER_COLLISION].Height(); }
+    bool Contains(int x, int y) const { return layers[LAYER_COLLISION].Contains(x, y); }
+    TileGrid& Collision() { return layers[LAYER_COLLISION]; }
+    const TileGrid& Collision() const { return layers[LAYER_COLLISION]; }
+
+    // Only the collision layer is required; the rest can be left empty.
+    bool HasVisualLayers() const {
+        for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+            if (layer != LAYER_COLLISION && !layers[layer].AllZero()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Pads every layer with 0 to the size of the largest one.
+    void Normalize() {
+        int width = 0, height = 0;
+        for (const TileGrid& grid : layers) {
+            width = grid.Width() > width ? grid.Width() : width;
+            height = grid.Height() > height ? grid.Height() : height;
+        }
+        for (TileGrid& grid : layers) {
+            if (grid.Width() != width || grid.Height() != height) {
+                grid = grid.Cropped(0, 0, width, height);
+            }
+        }
+    }
+
+    Level Snapshot() const { return *this; }
+
+    Level Clone() const {
+        Level out;
+        for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+            out.layers[layer] = layers[layer].Clone();
+        }
+        return out;
+    }
+
+    // fill only applies to the collision layer; new visual cells are empty.
+    Level Cropped(int x, int y, int w, int h, int fill = 0) const {
+        Level out;
+        for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+            out.layers[layer] = layers[layer].Cropped(x, y, w, h, layer == LAYER_COLLISION ? fill : 0);
+        }
+        return out;
+    }
+};
+
+#endif
@@ -0,0 +1,424 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "jobSystem.h"
+#include "levelIO.h"
+#include "levelLayers.h"
+#include "tileGrid.h"
+
+using namespace std;
+namespace fs = std::filesystem;
+
+// Headless level tool for the content pipeline: everything the editor can
+// do to a level file without opening a window. Any input may be a
+// directory, in which case every .txt/.lvl file under it is processed on
+// the job system and the output argument names a directory to mirror into.
+// Per-file reports are printed in path order once all jobs are done, and
+// the exit code is non-zero if any file failed.
+
+const int TILE_TYPES = 6;
+const int TILE_SOIL = 1;
+const int TILE_GRASS = 2;
+const int TILE_FLAG = 3;
+const int TILE_SPAWN = 5;
+// The game looks for the spawn tile on the first screen only (800x600 at
+// 32 pixels a tile), and assumes the level is at least that big.
+const int SCREEN_COLUMNS = 25;
+const int SCREEN_ROWS = 18;
+const char* const TEXT_EXTENSION = ".txt";
+const char* const BINARY_EXTENSION = ".lvl";
+
+struct FileTask {
+    string in, out;
+};
+
+struct FileResult {
+    bool ok;
+    string report;
+};
+
+typedef function<bool(const FileTask&, ostringstream&)> FileAction;
+
+static size_t taskGrain = 1;
+
+static void usage() {
+    cerr << "Usage: levelTool [-j threads] <command> ...\n"
+            "  convert <in> <out> [--text|--binary]   format defaults to the output extension (.lvl is binary)\n"
+            "  validate <in>...\n"
+            "  stats <in>...\n"
+            "  resize <in> <out> <width> <height> [fill]\n"
+            "  crop <in> <out> <x> <y> <width> <height>\n"
+            "  generate <outDir> <count> <width> <height> [seed]\n"
+            "Inputs may be directories; outputs then name directories too." << endl;
+}
+
+static bool isLevelFile(const fs::path& path) {
+    string ext = path.extension().string();
+    return ext == TEXT_EXTENSION || ext == BINARY_EXTENSION;
+}
+
+static bool parseInt(const char* text, int& value) {
+    char* end;
+    long v = strtol(text, &end, 10);
+    if (*text == '\0' || *end != '\0' || v < INT32_MIN || v > INT32_MAX) {
+        return false;
+    }
+    value = static_cast<int>(v);
+    return true;
+}
+
+static bool writeLevel(const string& path, const Level& level, bool binary) {
+    error_code ec;
+    fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) {
+        fs::create_directories(parent, ec);
+    }
+    return WriteFileAtomic(path, binary ? FormatLevelBinary(level) : FormatLevelText(level));
+}
+
+static bool isBinaryPath(const string& path) {
+    return fs::path(path).extension() == BINARY_EXTENSION;
+}
+
+// Expands in/out into one task per level file. outExtension replaces the
+// extension of mirrored outputs when non-empty.
+static bool collectTasks(const string& in, const string& out, const string& outExtension, vector<FileTask>& tasks) {
+    error_code ec;
+    if (!fs::is_directory(in, ec)) {
+        tasks.push_back({in, out});
+        return true;
+    }
+    vector<fs::path> files;
+    for (fs::recursive_directory_iterator it(in, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec) && isLevelFile(it->path())) {
+            files.push_back(it->path());
+        }
+    }
+    if (ec) {
+        cerr << "Error: Could not list " << in << ": " << ec.message() << endl;
+        return false;
+    }
+    sort(files.begin(), files.end());
+    for (const fs::path& file : files) {
+        fs::path target;
+        if (!out.empty()) {
+            target = fs::path(out) / fs::relative(file, in, ec);
+            if (!outExtension.empty()) {
+                target.replace_extension(outExtension);
+            }
+        }
+        tasks.push_back({file.string(), target.string()});
+    }
+    return true;
+}
+
+static bool runTasks(JobSystem& jobs, const vector<FileTask>& tasks, const FileAction& action) {
+    vector<FileResult> results(tasks.size());
+    jobs.ParallelFor(0, tasks.size(), taskGrain, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            // One bad file (e.g. bad_alloc on a hostile header) fails that
+            // file, not the whole batch.
+            ostringstream report;
+            try {
+                results[i].ok = action(tasks[i], report);
+                results[i].report = report.str();
+            } catch (const exception& e) {
+                results[i].ok = false;
+                results[i].report = string("failed: ") + e.what();
+            }
+        }
+    });
+    size_t failed = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        (results[i].ok ? cout : cerr) << tasks[i].in << ": " << results[i].report << '\n';
+        failed += results[i].ok ? 0 : 1;
+    }
+    if (tasks.size() > 1) {
+        cout << tasks.size() - failed << " of " << tasks.size() << " files ok" << endl;
+    }
+    return failed == 0;
+}
+
+static bool load(const string& path, Level& level, ostringstream& report) {
+    if (!ReadLevel(path, level)) {
+        report << "could not read level";
+        return false;
+    }
+    return true;
+}
+
+static int countBadTiles(const TileGrid& grid, int& firstBadX, int& firstBadY) {
+    int badTiles = 0;
+    for (int y = 0; y < grid.Height(); ++y) {
+        const vector<int>& row = grid.Row(y);
+        for (int x = 0; x < grid.Width(); ++x) {
+            if ((row[x] < 0 || row[x] >= TILE_TYPES) && badTiles++ == 0) {
+                firstBadX = x;
+                firstBadY = y;
+            }
+        }
+    }
+    return badTiles;
+}
+
+// Everything that would make the game misbehave on this level. Spawn and
+// flag only count on the collision layer.
+static bool validate(const Level& level, ostringstream& report) {
+    const TileGrid& grid = level.Collision();
+    vector<string> problems;
+    if (grid.Width() < SCREEN_COLUMNS || grid.Height() < SCREEN_ROWS) {
+        problems.push_back("smaller than one screen (" + to_string(SCREEN_COLUMNS) + "x" + to_string(SCREEN_ROWS) + ")");
+    }
+    int spawns = 0, flags = 0;
+    for (int y = 0; y < grid.Height(); ++y) {
+        const vector<int>& row = grid.Row(y);
+        for (int x = 0; x < grid.Width(); ++x) {
+            if (row[x] == TILE_SPAWN && x < SCREEN_COLUMNS && y < SCREEN_ROWS) {
+                ++spawns;
+            } else if (row[x] == TILE_FLAG) {
+                ++flags;
+            }
+        }
+    }
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        int firstBadX = -1, firstBadY = -1;
+        int badTiles = countBadTiles(level.layers[layer], firstBadX, firstBadY);
+        if (badTiles > 0) {
+            problems.push_back(to_string(badTiles) + " " + LAYER_NAMES[layer] + " tiles outside 0-" + to_string(TILE_TYPES - 1) +
+                               ", first at " + to_string(firstBadX) + "," + to_string(firstBadY));
+        }
+    }
+    if (spawns == 0) {
+        problems.push_back("no spawn (5) on the first screen");
+    }
+    if (flags == 0) {
+        problems.push_back("no flag (3)");
+    }
+    if (problems.empty()) {
+        report << "ok";
+        if (spawns > 1) {
+            report << " (" << spawns << " spawns, the game uses the last one)";
+        }
+        return true;
+    }
+    for (size_t i = 0; i < problems.size(); ++i) {
+        report << (i ? "; " : "") << problems[i];
+    }
+    return false;
+}
+
+static void stats(const Level& level, ostringstream& report) {
+    const TileGrid& grid = level.Collision();
+    long long counts[TILE_TYPES] = {};
+    long long other = 0, runs = 0;
+    int previous = 0;
+    for (int y = 0; y < grid.Height(); ++y) {
+        for (int tile : grid.Row(y)) {
+            if (tile >= 0 && tile < TILE_TYPES) {
+                counts[tile]++;
+            } else {
+                other++;
+            }
+            runs += (runs == 0 || tile != previous) ? 1 : 0;
+            previous = tile;
+        }
+    }
+    long long total = static_cast<long long>(grid.Width()) * grid.Height();
+    report << grid.Width() << "x" << grid.Height() << ", tiles";
+    for (int type = 0; type < TILE_TYPES; ++type) {
+        report << ' ' << type << '=' << counts[type];
+    }
+    if (other > 0) {
+        report << " other=" << other;
+    }
+    report << ", " << (total ? 100.0 * (total - counts[0]) / total : 0.0) << "% filled, " << runs << " runs";
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        if (layer == LAYER_COLLISION) {
+            continue;
+        }
+        long long used = 0;
+        for (int y = 0; y < level.layers[layer].Height(); ++y) {
+            for (int tile : level.layers[layer].Row(y)) {
+                used += tile != 0 ? 1 : 0;
+            }
+        }
+        if (used > 0) {
+            report << ", " << LAYER_NAMES[layer] << " " << used << " tiles";
+        }
+    }
+}
+
+// A walkable strip of soil topped with grass, with gaps and floating
+// platforms, the spawn above the first column and the flag on the last.
+// The ground sits on the first screen so the game finds the spawn.
+static Level generate(int width, int height, unsigned seed) {
+    Level level;
+    level.layers[LAYER_COLLISION] = TileGrid(width, height);
+    TileGrid& grid = level.Collision();
+    mt19937 rng(seed);
+    int ground = (height < SCREEN_ROWS ? height : SCREEN_ROWS) - 3;
+    for (int x = 0; x < width; ++x) {
+        bool gap = x > 4 && x < width - 4 && rng() % 12 == 0;
+        if (!gap) {
+            grid.Set(x, ground, TILE_GRASS);
+            for (int y = ground + 1; y < height; ++y) {
+                grid.Set(x, y, TILE_SOIL);
+            }
+        }
+        if (x > 4 && rng() % 9 == 0) {
+            int y = ground - 3 - static_cast<int>(rng() % 3);
+            int length = 2 + static_cast<int>(rng() % 4);
+            for (int i = 0; i < length && x + i < width && y > 0; ++i) {
+                grid.Set(x + i, y, TILE_GRASS);
+            }
+        }
+    }
+    grid.Set(1, ground - 1, TILE_SPAWN);
+    grid.Set(width - 2, ground - 1, TILE_FLAG);
+    level.Normalize();
+    return level;
+}
+
+int main(int argc, char* argv[]) {
+    int arg = 1;
+    unsigned threads = 0;
+    if (arg + 1 < argc && strcmp(argv[arg], "-j") == 0) {
+        int j;
+        if (!parseInt(argv[arg + 1], j) || j < 1) {
+            usage();
+            return 2;
+        }
+        // The calling thread works too.
+        threads = static_cast<unsigned>(j);
+        arg += 2;
+    }
+    if (arg >= argc) {
+        usage();
+        return 2;
+    }
+    string command = argv[arg++];
+    vector<char*> args(argv + arg, argv + argc);
+    // JobSystem(0) means one worker per core, so -j 1 keeps a worker but
+    // runs everything on this thread.
+    JobSystem jobs(threads > 1 ? threads - 1 : (threads == 1 ? 1 : 0));
+    taskGrain = threads == 1 ? SIZE_MAX : 1;
+    vector<FileTask> tasks;
+
+    if (command == "convert" && (args.size() == 2 || args.size() == 3)) {
+        bool binary = isBinaryPath(args[1]);
+        if (args.size() == 3) {
+            if (strcmp(args[2], "--binary") != 0 && strcmp(args[2], "--text") != 0) {
+                usage();
+                return 2;
+            }
+            binary = strcmp(args[2], "--binary") == 0;
+        }
+        if (!collectTasks(args[0], args[1], binary ? BINARY_EXTENSION : TEXT_EXTENSION, tasks)) {
+            return 1;
+        }
+        return runTasks(jobs, tasks, [binary](const FileTask& task, ostringstream& report) {
+            Level level;
+            if (!load(task.in, level, report)) {
+                return false;
+            }
+            if (!writeLevel(task.out, level, binary)) {
+                report << "could not write " << task.out;
+                return false;
+            }
+            report << "-> " << task.out;
+            return true;
+        }) ? 0 : 1;
+    }
+    if ((command == "validate" || command == "stats") && !args.empty()) {
+        for (char* in : args) {
+            if (!collectTasks(in, "", "", tasks)) {
+                return 1;
+            }
+        }
+        bool check = command == "validate";
+        return runTasks(jobs, tasks, [check](const FileTask& task, ostringstream& report) {
+            Level level;
+            if (!load(task.in, level, report)) {
+                return false;
+            }
+            if (check) {
+                return validate(level, report);
+            }
+            stats(level, report);
+            return true;
+        }) ? 0 : 1;
+    }
+    if ((command == "resize" && (args.size() == 4 || args.size() == 5)) || (command == "crop" && args.size() == 6)) {
+        int numbers[4] = {0, 0, 0, 0};
+        int* window = command == "resize" ? numbers + 2 : numbers;
+        int fill = 0;
+        for (size_t i = 2; i < 6 && i < args.size(); ++i) {
+            if (!parseInt(args[i], window[i - 2])) {
+                usage();
+                return 2;
+            }
+        }
+        if (command == "resize" && args.size() == 5 && !parseInt(args[4], fill)) {
+            usage();
+            return 2;
+        }
+        int x = numbers[0], y = numbers[1], width = numbers[2], height = numbers[3];
+        if (width <= 0 || height <= 0 || static_cast<long long>(width) * height > (1 << 30)) {
+            cerr << "Error: Invalid size " << width << "x" << height << endl;
+            return 2;
+        }
+        if (!collectTasks(args[0], args[1], "", tasks)) {
+            return 1;
+        }
+        return runTasks(jobs, tasks, [=](const FileTask& task, ostringstream& report) {
+            Level level;
+            if (!load(task.in, level, report)) {
+                return false;
+            }
+            int oldWidth = level.Width(), oldHeight = level.Height();
+            level = level.Cropped(x, y, width, height, fill);
+            if (!writeLevel(task.out, level, isBinaryPath(task.out))) {
+                report << "could not write " << task.out;
+                return false;
+            }
+            report << oldWidth << "x" << oldHeight << " -> " << width << "x" << height << " " << task.out;
+            return true;
+        }) ? 0 : 1;
+    }
+    if (command == "generate" && (args.size() == 4 || args.size() == 5)) {
+        int count, width, height, seed = 1;
+        if (!parseInt(args[1], count) || !parseInt(args[2], width) || !parseInt(args[3], height) ||
+            (args.size() == 5 && !parseInt(args[4], seed))) {
+            usage();
+            return 2;
+        }
+        if (count < 0 || width < SCREEN_COLUMNS || height < SCREEN_ROWS || static_cast<long long>(width) * height > (1 << 30)) {
+            cerr << "Error: Levels must be at least " << SCREEN_COLUMNS << "x" << SCREEN_ROWS << endl;
+            return 2;
+        }
+        for (int i = 0; i < count; ++i) {
+            string name = "level_" + to_string(i) + TEXT_EXTENSION;
+            tasks.push_back({name, (fs::path(args[0]) / name).string()});
+        }
+        return runTasks(jobs, tasks, [&tasks, width, height, seed](const FileTask& task, ostringstream& report) {
+            size_t index = &task - tasks.data();
+            Level level = generate(width, height, static_cast<unsigned>(seed) * 7919u + static_cast<unsigned>(index));
+            if (!writeLevel(task.out, level, false)) {
+                report << "could not write " << task.out;
+                return false;
+            }
+            report << "-> " << task.out;
+            return true;
+        }) ? 0 : 1;
+    }
+    usage();
+    return 2;
+}
@@ -0,0 +1,365 @@
+#ifndef LIVE_LINK_H
+#define LIVE_LINK_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Live playtest link: the level editor publishes every tile it changes into
+// a named shared-memory region and a running game applies them on its next
+// simulation tick, with no file I/O on either side. There is one writer
+// (the editor) and any number of readers.
+//
+// The region holds a header, a ring of the most recent edits and a mirror
+// of every layer of the editor's grid. The writer stores the tile in the mirror,
+// then the ring slot, then bumps the sequence counter with release order.
+// A reader that sees sequence s therefore sees every edit before s, both in
+// the mirror and in the ring. Readers keep their own cursor. If the writer
+// has lapped the ring since the last poll (a huge fill, or a game that was
+// paused), the reader copies the mirror and continues from the sequence it
+// read first; replaying a few edits twice is harmless because edits are
+// absolute values.
+
+const char* const LIVE_LINK_NAME = "/level_live_link";
+const uint32_t LIVE_LINK_MAGIC = 0x4B4E4C4C;
+const uint32_t LIVE_LINK_VERSION = 2;
+const uint32_t LIVE_LINK_CAPACITY = 1 << 16;
+
+struct LiveLinkHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t totalBytes;
+    int32_t width;
+    int32_t height;
+    int32_t layers;
+    uint32_t capacity;
+    std::atomic<uint32_t> alive;
+    std::atomic<uint64_t> sequence;
+};
+
+struct LiveEdit {
+    std::atomic<int32_t> layer;
+    std::atomic<int32_t> x;
+    std::atomic<int32_t> y;
+    std::atomic<int32_t> type;
+};
+
+// A named, process-shared memory mapping.
+class SharedMemory {
+public:
+    SharedMemory() : data(nullptr), size(0) {
+#ifdef _WIN32
+        mapping = nullptr;
+#endif
+    }
+    ~SharedMemory() { Close(); }
+
+    // Replaces any existing region of that name.
+    bool Create(const char* name, size_t bytes) {
+        Close();
+#ifdef _WIN32
+        mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                     static_cast<DWORD>(static_cast<uint64_t>(bytes) >> 32), static_cast<DWORD>(bytes), WindowsName(name));
+        if (!mapping) {
+            return false;
+        }
+        data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+#else
+        shm_unlink(name);
+        int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            close(fd);
+            shm_unlink(name);
+            return false;
+        }
+        data = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            data = nullptr;
+        }
+#endif
+        size = data ? bytes : 0;
+        if (data) {
+            created = name;
+        }
+        return data != nullptr;
+    }
+
+    bool Open(const char* name) {
+        Close();
+#ifdef _WIN32
+        mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, WindowsName(name));
+        if (!mapping) {
+            return false;
+        }
+        data = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+        MEMORY_BASIC_INFORMATION info;
+        size = data && VirtualQuery(data, &info, sizeof(info)) ? info.RegionSize : 0;
+#else
+        int fd = shm_open(name, O_RDWR, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size = static_cast<size_t>(st.st_size);
+            data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (data == MAP_FAILED) {
+                data = nullptr;
+            }
+        }
+        close(fd);
+#endif
+        if (!data) {
+            size = 0;
+        }
+        return data != nullptr;
+    }
+
+    void Close() {
+#ifdef _WIN32
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+            mapping = nullptr;
+        }
+#else
+        if (data) {
+            munmap(data, size);
+        }
+        if (!created.empty()) {
+            shm_unlink(created.c_str());
+        }
+#endif
+        created.clear();
+        data = nullptr;
+        size = 0;
+    }
+
+    void* Data() const { return data; }
+    size_t Size() const { return size; }
+
+private:
+    void* data;
+    size_t size;
+    std::string created;
+#ifdef _WIN32
+    HANDLE mapping;
+
+    // "Local\\level_live_link": no leading slash, per-session namespace.
+    static const char* WindowsName(const char* name) {
+        static thread_local char buffer[128];
+        snprintf(buffer, sizeof(buffer), "Local\\%s", name[0] == '/' ? name + 1 : name);
+        return buffer;
+    }
+#endif
+};
+
+inline size_t LiveLinkBytes(int width, int height, int layers, uint32_t capacity) {
+    return sizeof(LiveLinkHeader) + sizeof(LiveEdit) * capacity +
+           sizeof(std::atomic<int32_t>) * static_cast<size_t>(width) * height * layers;
+}
+
+// Editor side.
+class LiveLinkWriter {
+public:
+    LiveLinkWriter() : header(nullptr), ring(nullptr), tiles(nullptr) {}
+    ~LiveLinkWriter() { Close(); }
+
+    // get(layer, x, y) supplies the current grid for the mirror.
+    template <typename Get>
+    bool Create(int width, int height, int layers, Get get, const char* name = LIVE_LINK_NAME) {
+        Close();
+        // Tell readers still attached to an older region to let go of it.
+        SharedMemory old;
+        if (old.Open(name) && old.Size() >= sizeof(LiveLinkHeader)) {
+            static_cast<LiveLinkHeader*>(old.Data())->alive.store(0, std::memory_order_release);
+        }
+        old.Close();
+
+        size_t bytes = LiveLinkBytes(width, height, layers, LIVE_LINK_CAPACITY);
+        if (!memory.Create(name, bytes)) {
+            return false;
+        }
+        Map(memory.Data());
+        header->magic = LIVE_LINK_MAGIC;
+        header->version = LIVE_LINK_VERSION;
+        header->totalBytes = bytes;
+        header->width = width;
+        header->height = height;
+        header->layers = layers;
+        header->capacity = LIVE_LINK_CAPACITY;
+        header->sequence.store(0, std::memory_order_relaxed);
+        for (int layer = 0; layer < layers; ++layer) {
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    tiles[(static_cast<size_t>(layer) * height + y) * width + x].store(get(layer, x, y), std::memory_order_relaxed);
+                }
+            }
+        }
+        header->alive.store(1, std::memory_order_release);
+        return true;
+    }
+
+    bool Connected() const { return header != nullptr; }
+
+    void Publish(int layer, int x, int y, int type) {
+        if (!header || layer < 0 || x < 0 || y < 0 || layer >= header->layers || x >= header->width || y >= header->height) {
+            return;
+        }
+        uint64_t seq = header->sequence.load(std::memory_order_relaxed);
+        // Orders the previous sequence store before the slot stores below,
+        // which is what lets readers detect a slot being overwritten.
+        std::atomic_thread_fence(std::memory_order_release);
+        tiles[(static_cast<size_t>(layer) * header->height + y) * header->width + x].store(type, std::memory_order_relaxed);
+        LiveEdit& slot = ring[seq & (header->capacity - 1)];
+        slot.layer.store(layer, std::memory_order_relaxed);
+        slot.x.store(x, std::memory_order_relaxed);
+        slot.y.store(y, std::memory_order_relaxed);
+        slot.type.store(type, std::memory_order_relaxed);
+        header->sequence.store(seq + 1, std::memory_order_release);
+    }
+
+    void Close() {
+        if (header) {
+            header->alive.store(0, std::memory_order_release);
+        }
+        memory.Close();
+        header = nullptr;
+        ring = nullptr;
+        tiles = nullptr;
+    }
+
+private:
+    SharedMemory memory;
+    LiveLinkHeader* header;
+    LiveEdit* ring;
+    std::atomic<int32_t>* tiles;
+
+    void Map(void* base) {
+        header = new (base) LiveLinkHeader();
+        ring = new (header + 1) LiveEdit[LIVE_LINK_CAPACITY];
+        tiles = reinterpret_cast<std::atomic<int32_t>*>(ring + LIVE_LINK_CAPACITY);
+    }
+};
+
+// Game side. Poll() from the thread that owns the level.
+class LiveLinkReader {
+public:
+    LiveLinkReader() : header(nullptr), ring(nullptr), tiles(nullptr), cursor(0), forceResync(false), resyncs(0) {}
+
+    // Fails quietly when no editor is running; call again later.
+    bool Open(const char* name = LIVE_LINK_NAME) {
+        Close();
+        if (!memory.Open(name) || memory.Size() < sizeof(LiveLinkHeader)) {
+            memory.Close();
+            return false;
+        }
+        LiveLinkHeader* h = static_cast<LiveLinkHeader*>(memory.Data());
+        if (h->magic != LIVE_LINK_MAGIC || h->version != LIVE_LINK_VERSION || !h->alive.load(std::memory_order_acquire) ||
+            memory.Size() < LiveLinkBytes(h->width, h->height, h->layers, h->capacity)) {
+            memory.Close();
+            return false;
+        }
+        header = h;
+        ring = reinterpret_cast<LiveEdit*>(header + 1);
+        tiles = reinterpret_cast<std::atomic<int32_t>*>(ring + header->capacity);
+        // Start from the editor's current grid.
+        cursor = 0;
+        forceResync = true;
+        return true;
+    }
+
+    bool Connected() const { return header != nullptr; }
+
+    void Close() {
+        memory.Close();
+        header = nullptr;
+        ring = nullptr;
+        tiles = nullptr;
+    }
+
+    // Calls apply(layer, x, y, type) for every edit published since the last call
+    // (or for every tile after a resync) and returns how many calls were
+    // made. Disconnects when the editor goes away.
+    template <typename Apply>
+    size_t Poll(Apply apply) {
+        if (!header) {
+            return 0;
+        }
+        if (!header->alive.load(std::memory_order_acquire)) {
+            Close();
+            return 0;
+        }
+        uint64_t end = header->sequence.load(std::memory_order_acquire);
+        if (forceResync || end - cursor >= header->capacity) {
+            return Resync(apply);
+        }
+        const uint64_t mask = header->capacity - 1;
+        size_t applied = 0;
+        for (uint64_t seq = cursor; seq < end; ++seq) {
+            const LiveEdit& e = ring[seq & mask];
+            int layer = e.layer.load(std::memory_order_relaxed);
+            int x = e.x.load(std::memory_order_relaxed);
+            int y = e.y.load(std::memory_order_relaxed);
+            int type = e.type.load(std::memory_order_relaxed);
+            // The writer may have lapped this slot while it was read.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) - seq >= header->capacity) {
+                return applied + Resync(apply);
+            }
+            apply(layer, x, y, type);
+            ++applied;
+        }
+        cursor = end;
+        return applied;
+    }
+
+    unsigned long long Resyncs() const { return resyncs; }
+
+private:
+    SharedMemory memory;
+    LiveLinkHeader* header;
+    LiveEdit* ring;
+    std::atomic<int32_t>* tiles;
+    uint64_t cursor;
+    bool forceResync;
+    unsigned long long resyncs;
+
+    template <typename Apply>
+    size_t Resync(Apply apply) {
+        uint64_t start = header->sequence.load(std::memory_order_acquire);
+        const int width = header->width, height = header->height, layers = header->layers;
+        for (int layer = 0; layer < layers; ++layer) {
+            for (int y = 0; y < height; ++y) {
+                for (int x = 0; x < width; ++x) {
+                    apply(layer, x, y, tiles[(static_cast<size_t>(layer) * height + y) * width + x].load(std::memory_order_relaxed));
+                }
+            }
+        }
+        cursor = start;
+        forceResync = false;
+        ++resyncs;
+        return static_cast<size_t>(width) * height * layers;
+    }
+};
+
+#endif
@@ -0,0 +1,2 @@
+liveLinkTest:
+	g++ -O2 -pthread -o liveLinkTest liveLinkTest.cpp
@@ -0,0 +1,107 @@
+#include "liveLink.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Headless check for liveLink.h: an editor-side writer and a game-side
+// reader run on two threads against a real named shared-memory region. The
+// writer makes random single-tile edits, lines and occasional fills larger
+// than the edit ring (forcing the reader to resync from the mirror); the
+// reader polls once per simulated 8 ms tick like GameEngine does. Edits
+// are spread over several layers. Exits non-zero unless both grids end up
+// identical.
+
+static const char* const TEST_LINK_NAME = "/level_live_link_test";
+static const int TEST_LAYERS = 4;
+
+int main(int argc, char** argv) {
+    int width = argc > 1 ? atoi(argv[1]) : 1000;
+    int height = argc > 2 ? atoi(argv[2]) : 300;
+    int edits = argc > 3 ? atoi(argv[3]) : 200000;
+
+    mt19937 rng(1234);
+    const size_t layerSize = static_cast<size_t>(width) * height;
+    vector<int> editor(layerSize * TEST_LAYERS);
+    for (int& t : editor) {
+        t = rng() % 6;
+    }
+    LiveLinkWriter writer;
+    auto at = [&](int layer, int x, int y) { return layer * layerSize + static_cast<size_t>(y) * width + x; };
+    if (!writer.Create(width, height, TEST_LAYERS, [&](int layer, int x, int y) { return editor[at(layer, x, y)]; }, TEST_LINK_NAME)) {
+        cerr << "Could not create shared memory" << endl;
+        return 1;
+    }
+
+    // The game starts from its own (stale) copy of the level.
+    vector<int> game(editor.size(), 0);
+    atomic<bool> writerDone(false);
+    unsigned long long applied = 0, resyncs = 0;
+    thread reader([&] {
+        LiveLinkReader link;
+        while (!link.Open(TEST_LINK_NAME)) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        auto apply = [&](int layer, int x, int y, int type) {
+            if (layer >= 0 && layer < TEST_LAYERS && y >= 0 && y < height && x >= 0 && x < width) {
+                game[at(layer, x, y)] = type;
+            }
+        };
+        for (;;) {
+            bool done = writerDone.load();
+            applied += link.Poll(apply);
+            if (done) {
+                break;
+            }
+            this_thread::sleep_for(chrono::milliseconds(8));
+        }
+        resyncs = link.Resyncs();
+    });
+
+    auto set = [&](int layer, int x, int y, int type) {
+        if (x >= 0 && y >= 0 && x < width && y < height) {
+            editor[at(layer, x, y)] = type;
+            writer.Publish(layer, x, y, type);
+        }
+    };
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < edits; ++i) {
+        int kind = rng() % 1000;
+        int layer = rng() % TEST_LAYERS, x = rng() % width, y = rng() % height, type = rng() % 6;
+        if (kind == 0) {
+            // Bigger than the ring.
+            for (int fy = 0; fy < height; ++fy) {
+                for (int fx = 0; fx < width && fx < 400; ++fx) {
+                    set(layer, fx, fy, type);
+                }
+            }
+        } else if (kind < 50) {
+            int x1 = rng() % width;
+            for (int fx = min(x, x1); fx <= max(x, x1); ++fx) {
+                set(layer, fx, y, type);
+            }
+        } else {
+            set(layer, x, y, type);
+        }
+        if (i % 1000 == 0) {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+    }
+    double elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    writerDone = true;
+    reader.join();
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < editor.size(); ++i) {
+        mismatches += game[i] != editor[i];
+    }
+    cout << width << "x" << height << "x" << TEST_LAYERS << " grid, " << edits << " edit operations in " << elapsed << " ms" << endl;
+    cout << "reader applied " << applied << " updates, " << resyncs << " resyncs" << endl;
+    cout << (mismatches == 0 ? "PASS: grids converged" : "FAIL: grids differ") << " (" << mismatches << " mismatched tiles)" << endl;
+    return mismatches == 0 ? 0 : 1;
+}
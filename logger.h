@@ -0,0 +1,312 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Asynchronous logger. A log call copies its format pointer and arguments
+// into a fixed-size record in a lock-free ring owned by the calling thread;
+// a background thread formats the records and does the actual I/O. Calls
+// below LOG_LEVEL expand to nothing, arguments included.
+//
+//     LOG_INFO("Loaded {}x{} level", width, height);
+//
+// The format must be a string literal. Strings passed as arguments are
+// copied (and truncated to fit the record), everything else is stored raw.
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Logger::Instance().Write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_INFO
+#define LOG_INFO(...) Logger::Instance().Write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_WARN
+#define LOG_WARN(...) Logger::Instance().Write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) ((void)0)
+#endif
+
+#if LOG_LEVEL <= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Logger::Instance().Write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) ((void)0)
+#endif
+
+enum LogArgType { LOG_ARG_INT, LOG_ARG_UINT, LOG_ARG_DOUBLE, LOG_ARG_STRING };
+
+struct LogArg {
+    LogArgType type;
+    union {
+        long long i;
+        unsigned long long u;
+        double d;
+        struct {
+            uint16_t offset;
+            uint16_t length;
+        } s;
+    };
+};
+
+struct LogRecord {
+    static const int MAX_ARGS = 8;
+    static const int TEXT_SIZE = 96;
+
+    const char* format;
+    int64_t timestamp;
+    uint8_t level;
+    uint8_t argCount;
+    uint16_t textUsed;
+    LogArg args[MAX_ARGS];
+    char text[TEXT_SIZE];
+};
+
+// Single-producer (the owning thread) / single-consumer (the flusher) ring.
+class ThreadLogBuffer {
+public:
+    static const size_t CAPACITY = 1024;
+
+    ThreadLogBuffer() : head(0), tail(0), dropped(0) {}
+
+    LogRecord* BeginWrite() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        return &records[t % CAPACITY];
+    }
+    void EndWrite() { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    bool Pop(LogRecord& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        out = records[h % CAPACITY];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    unsigned long long TakeDropped() { return dropped.exchange(0, std::memory_order_relaxed); }
+
+private:
+    LogRecord records[CAPACITY];
+    std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    std::atomic<unsigned long long> dropped;
+};
+
+class Logger {
+public:
+    static Logger& Instance() {
+        static Logger logger;
+        return logger;
+    }
+
+    template <typename... Args>
+    void Write(int level, const char* format, const Args&... args) {
+        ThreadLogBuffer& buffer = LocalBuffer();
+        LogRecord* record = buffer.BeginWrite();
+        if (!record) {
+            return;
+        }
+        record->format = format;
+        record->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        record->level = static_cast<uint8_t>(level);
+        record->argCount = 0;
+        record->textUsed = 0;
+        int expand[] = {0, (Encode(*record, args), 0)...};
+        (void)expand;
+        buffer.EndWrite();
+    }
+
+    // Formats and writes everything queued so far, then stops the flusher.
+    // Safe to call more than once; later Write() calls are still queued but
+    // nothing prints them.
+    void Shutdown() {
+        if (running.exchange(false) && flusher.joinable()) {
+            flusher.join();
+        }
+        Flush();
+    }
+
+    ~Logger() { Shutdown(); }
+
+private:
+    std::vector<ThreadLogBuffer*> buffers;
+    std::mutex buffersLock;
+    std::atomic<bool> running;
+    std::thread flusher;
+    std::chrono::steady_clock::time_point start;
+    std::vector<LogRecord> batch;
+    std::string out;
+    std::string err;
+
+    Logger() : running(true), start(std::chrono::steady_clock::now()) {
+        flusher = std::thread([this] {
+            while (running) {
+                Flush();
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            }
+        });
+    }
+
+    // One ring per thread, created and registered on the first log call from
+    // that thread. Buffers are kept for the life of the logger so records
+    // from threads that already exited still get printed.
+    ThreadLogBuffer& LocalBuffer() {
+        static thread_local ThreadLogBuffer* local = nullptr;
+        if (!local) {
+            local = new ThreadLogBuffer();
+            std::lock_guard<std::mutex> guard(buffersLock);
+            buffers.push_back(local);
+        }
+        return *local;
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type
+    Encode(LogRecord& r, const T& value) {
+        if (r.argCount == LogRecord::MAX_ARGS) {
+            return;
+        }
+        LogArg& a = r.args[r.argCount++];
+        if (std::is_signed<T>::value || std::is_enum<T>::value) {
+            a.type = LOG_ARG_INT;
+            a.i = static_cast<long long>(value);
+        } else {
+            a.type = LOG_ARG_UINT;
+            a.u = static_cast<unsigned long long>(value);
+        }
+    }
+    template <typename T>
+    static typename std::enable_if<std::is_floating_point<T>::value>::type
+    Encode(LogRecord& r, const T& value) {
+        if (r.argCount == LogRecord::MAX_ARGS) {
+            return;
+        }
+        LogArg& a = r.args[r.argCount++];
+        a.type = LOG_ARG_DOUBLE;
+        a.d = value;
+    }
+    static void Encode(LogRecord& r, const char* value) { EncodeString(r, value ? value : "(null)", value ? strlen(value) : 6); }
+    static void Encode(LogRecord& r, const std::string& value) { EncodeString(r, value.data(), value.size()); }
+
+    static void EncodeString(LogRecord& r, const char* value, size_t length) {
+        if (r.argCount == LogRecord::MAX_ARGS) {
+            return;
+        }
+        size_t room = LogRecord::TEXT_SIZE - r.textUsed;
+        if (length > room) {
+            length = room;
+        }
+        LogArg& a = r.args[r.argCount++];
+        a.type = LOG_ARG_STRING;
+        a.s.offset = r.textUsed;
+        a.s.length = static_cast<uint16_t>(length);
+        memcpy(r.text + r.textUsed, value, length);
+        r.textUsed = static_cast<uint16_t>(r.textUsed + length);
+    }
+
+    static void Format(const LogRecord& r, std::string& dest) {
+        static const char* levelNames[] = {"DEBUG", "INFO ", "WARN ", "ERROR"};
+        char scratch[64];
+        snprintf(scratch, sizeof(scratch), "[%10.3f] %s ", r.timestamp / 1000.0, levelNames[r.level]);
+        dest += scratch;
+        int next = 0;
+        for (const char* p = r.format; *p; ++p) {
+            if (p[0] != '{' || p[1] != '}' || next >= r.argCount) {
+                dest += *p;
+                continue;
+            }
+            const LogArg& a = r.args[next++];
+            switch (a.type) {
+                case LOG_ARG_INT:
+                    snprintf(scratch, sizeof(scratch), "%lld", a.i);
+                    dest += scratch;
+                    break;
+                case LOG_ARG_UINT:
+                    snprintf(scratch, sizeof(scratch), "%llu", a.u);
+                    dest += scratch;
+                    break;
+                case LOG_ARG_DOUBLE:
+                    snprintf(scratch, sizeof(scratch), "%g", a.d);
+                    dest += scratch;
+                    break;
+                case LOG_ARG_STRING:
+                    dest.append(r.text + a.s.offset, a.s.length);
+                    break;
+            }
+            ++p;
+        }
+        dest += '\n';
+    }
+
+    void Flush() {
+        unsigned long long dropped = 0;
+        batch.clear();
+        {
+            std::lock_guard<std::mutex> guard(buffersLock);
+            LogRecord r;
+            for (ThreadLogBuffer* b : buffers) {
+                while (b->Pop(r)) {
+                    batch.push_back(r);
+                }
+                dropped += b->TakeDropped();
+            }
+        }
+        if (batch.empty() && dropped == 0) {
+            return;
+        }
+        // Interleave threads in call order.
+        std::stable_sort(batch.begin(), batch.end(), [](const LogRecord& a, const LogRecord& b) {
+            return a.timestamp < b.timestamp;
+        });
+        out.clear();
+        err.clear();
+        for (const LogRecord& r : batch) {
+            Format(r, r.level >= LOG_LEVEL_WARN ? err : out);
+        }
+        if (dropped) {
+            char scratch[64];
+            snprintf(scratch, sizeof(scratch), "logger: dropped %llu records\n", dropped);
+            err += scratch;
+        }
+        if (!out.empty()) {
+            fwrite(out.data(), 1, out.size(), stdout);
+            fflush(stdout);
+        }
+        if (!err.empty()) {
+            fwrite(err.data(), 1, err.size(), stderr);
+            fflush(stderr);
+        }
+    }
+};
+
+#endif
@@ -1,27 +1,103 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
-#include <fstream>
-#include <sstream>
+#include <SDL2/SDL_mixer.h>
+#include <cstring>
 #include <iostream>
 #include <vector>
 #include <unordered_map>
+#include <atomic>
+#include <thread>
+#include "autotile.h"
+#include "collisionMask.h"
+#include "eventBus.h"
+#include "fixedPoint.h"
+#include "fontAtlas.h"
+#include "jobSystem.h"
+#include "levelIO.h"
+#include "levelLayers.h"
+#include "liveLink.h"
+#include "logger.h"
+#include "mpscRing.h"
+#include "musicStream.h"
+#include "playerPhysics.h"
+#include "positionalAudio.h"
+#include "sceneManager.h"
+#include "sfxSynth.h"
+#include "sfxSystem.h"
+#include "tileAtlas.h"
+#include "softMixer.h"
+#include "tripleBuffer.h"
 
 const int SCREEN_WIDTH = 800;
 const int SCREEN_HEIGHT = 600;
 const int TILE_SIZE = 32;
+const int SIM_TICK_MS = 8;
+// How often the simulation looks for a running level editor.
+const int LIVE_LINK_RETRY_TICKS = 1000 / SIM_TICK_MS;
+// Tile edits in flight from the simulation to the render thread.
+const size_t TILE_QUEUE_SIZE = 4096;
+const int PLAY_FPS_CAP = 120;
+const int WIN_FPS_CAP = 30;
+const int IDLE_TIMEOUT_MS = 500;
+// How long the last frame stays up after the last life is lost.
+const int LOSE_SCREEN_MS = 1000;
+const int HUD_TEXT_SIZE = 16;
+const int WIN_TEXT_SIZE = 12;
+const int SFX_CHANNELS = 16;
+// Positional sounds fade out over this many pixels from the camera centre.
+const float SFX_CULL_RADIUS = SCREEN_WIDTH * 1.5f;
+const Fixed GRAVITY = Fixed::FromInt(1);
+const Fixed DEFAULT_MAX_STEP = Fixed::FromInt(TILE_SIZE / 4);
+const int DEFAULT_MAX_SUBSTEPS = 8;
 
 using namespace std;
 
 class Player {
 private:
-    int x, y, SPEED, JUMP_VELOCITY, lives;
+    Fixed x, y, SPEED, JUMP_VELOCITY;
+    int lives;
 public:
-    Player() : x(SCREEN_WIDTH/2), y(SCREEN_HEIGHT/2), SPEED(3), JUMP_VELOCITY(15), lives(3) {};
-    Player(int X, int Y, int sp, int jv) : x(X), y(Y), SPEED(sp), JUMP_VELOCITY(jv), lives(3) {};
+    Player() : x(Fixed::FromInt(SCREEN_WIDTH/2)), y(Fixed::FromInt(SCREEN_HEIGHT/2)), SPEED(Fixed::FromInt(3)), JUMP_VELOCITY(Fixed::FromInt(15)), lives(3) {};
+    Player(Fixed X, Fixed Y, Fixed sp, Fixed jv) : x(X), y(Y), SPEED(sp), JUMP_VELOCITY(jv), lives(3) {};
     friend class GameEngine;
 };
 
+enum MainScene {
+    SCENE_PLAYING,
+    SCENE_WON,
+    SCENE_LOST
+};
+
+enum GameOutcome {
+    OUTCOME_PLAYING,
+    OUTCOME_WON,
+    OUTCOME_LOST
+};
+
+struct TileChange {
+    int layer, x, y, type;
+};
+
+struct GameStats {
+    int deaths;
+    int respawns;
+    int jumps;
+};
+
+// Everything the render thread needs from one simulation tick. Only the
+// latest one matters, so tile edits travel separately through tileChanges.
+// Once outcome leaves OUTCOME_PLAYING the simulation has stopped and the
+// render thread ends the run. The outcome travels here rather than on the
+// event bus because the bus may drop events and the end of a run must not
+// be lost.
+struct WorldSnapshot {
+    int playerX, playerY, lives, score;
+    GameOutcome outcome;
+
+    WorldSnapshot() : playerX(0), playerY(0), lives(0), score(0), outcome(OUTCOME_PLAYING) {}
+};
+
 class GameEngine {
 public:
     GameEngine();
@@ -31,203 +107,438 @@ public:
     void Run();
     void Shutdown();
     void Update();
+    void SetSubstepping(Fixed maxStep, int maxSubsteps);
+    // Before Initialize(): play effects through SoftMixer instead of the
+    // SDL_mixer channel pool. Music is streamed through it either way.
+    void UseSoftMixer(bool enabled) { softMixerEnabled = enabled; }
+    const SubstepStats& GetSubstepStats() const { return substepStats; }
 
 private:
     SDL_Window* window;
     SDL_Renderer* renderer;
-    unordered_map<int, SDL_Texture*> tileTexture;
+    TileAtlas tileAtlas;
     unordered_map<int, SDL_Texture*> Life;
-    TTF_Font *font;  
+    FontAtlas fontAtlas;
+    TextRenderer text;
     SDL_Texture* playerTexture;
     SDL_Texture* bg;
-    SDL_Texture* fg;
-    SDL_Texture* tt;
     Player py;
-    bool isRunning;
-    bool left;
-    bool right;
-    bool jump;
+    atomic<bool> isRunning;
+    atomic<bool> left;
+    atomic<bool> right;
+    atomic<bool> jump;
     bool isJumping;
     bool won;
+    bool lost;
     int velocityX;
-    int velocityY;
+    Fixed velocityY;
     int startX, startY;
-
-    vector<vector<int>> levelData;
+    int bestColumn;
+    // HUD state, render thread only.
+    Uint64 runStartTicks, runEndTicks, fpsWindowStart;
+    int framesThisWindow, fps;
+    SubstepConfig substepConfig;
+    SubstepStats substepStats;
+
+    // level and solids belong to the simulation thread, renderLevel to the
+    // render thread; the two are kept in sync through tileChanges, which the
+    // render thread drains in order every frame. Edits that do not fit in the
+    // ring wait in pendingTiles for the next tick. Collision only ever looks
+    // at solids.
+    Level level;
+    CollisionMask solids;
+    Level renderLevel;
+    vector<TileChange> pendingTiles;
+    MpscRing<TileChange, TILE_QUEUE_SIZE> tileChanges;
+    // Render thread: every layer is drawn once into its own screen-sized
+    // target and afterwards only the tiles that change are redrawn, so each
+    // layer costs one copy per frame. layerTiles counts what a layer draws
+    // so empty layers are skipped. renderAutotile picks the ground variants
+    // and marks the neighbours of an edited tile dirty when theirs change.
+    SDL_Texture* layerTargets[LAYER_COUNT];
+    Autotiler renderAutotile[LAYER_COUNT];
+    vector<SDL_Point> layerDirty[LAYER_COUNT];
+    bool layerFullRedraw[LAYER_COUNT];
+    int layerTiles[LAYER_COUNT];
+    TripleBuffer<WorldSnapshot> snapshots;
+    // Tile edits from a running level editor, simulation thread only.
+    LiveLinkReader liveLink;
+    int liveLinkRetry;
+    EventBus events;
+    SfxSystem sfx;
+    int jumpSound, landSound, deathSound, winSound;
+    MusicStream music;
+    SoftMixer softMixer;
+    PositionalAudio positional;
+    bool softMixerEnabled;
+    vector<int> softSoundOf;
+    SceneManager scenes;
+    GameStats stats;
+    thread simThread;
+    JobSystem jobs;
 
     void LoadLevelConfiguration(const std::string& configFile);
-    void RenderScene();
+    void RenderScene(const WorldSnapshot& snap);
     void Render();
-    int checkCollision(int);
+    void SimulationLoop();
+    void SubscribeEvents();
+    void LoadSounds();
+    void PlaySound(int sound, int x, int y);
+    void PublishSnapshot();
+    void SetTile(int layer, int x, int y, int type);
+    void PollLiveLink();
+    static int TileOf(Fixed v) { return FloorDiv(v.FloorToInt(), TILE_SIZE); }
     void handleInput();
     void LoadTextures();
+    void CreateLayerTargets();
+    void UpdateLayerTargets();
+    void DrawLayer(int layer);
     bool winCheck();
-    void win();
+    void DrawEndScreen(const char* message);
+    void DrawHud(const WorldSnapshot& snap);
 };
 
-GameEngine::GameEngine() : window(nullptr), renderer(nullptr), isRunning(false), left(false), right(false), jump(false), isJumping(false), velocityX(0), velocityY(0), won(false) {};
+GameEngine::GameEngine() : window(nullptr), renderer(nullptr), text(fontAtlas), isRunning(false), left(false), right(false), jump(false), isJumping(false), won(false), lost(false), velocityX(0), velocityY(), bestColumn(0), runStartTicks(0), runEndTicks(0), fpsWindowStart(0), framesThisWindow(0), fps(0), substepConfig{DEFAULT_MAX_STEP, DEFAULT_MAX_SUBSTEPS}, substepStats(), liveLinkRetry(0), jumpSound(-1), landSound(-1), deathSound(-1), winSound(-1), positional(softMixer, SFX_CULL_RADIUS, SCREEN_WIDTH / 2.0f), softMixerEnabled(false), stats() {
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        layerTargets[layer] = nullptr;
+        layerFullRedraw[layer] = true;
+        layerTiles[layer] = 0;
+    }
+};
 
 GameEngine::~GameEngine() {
     Shutdown();
 }
 
 void GameEngine::Initialize(const char* title, int width, int height) {
-    cout << "Init";
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        cerr << "SDL initialization error: " << SDL_GetError() << std::endl;
+    LOG_INFO("Init");
+    if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO) < 0) {
+        LOG_ERROR("SDL initialization error: {}", SDL_GetError());
         return;
     }
     TTF_Init();
+    IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG);
 
     window = SDL_CreateWindow(title, 50, 50, width, height, SDL_WINDOW_SHOWN);
     if (!window) {
-        cerr << "Window creation error: " << SDL_GetError() << std::endl;
+        LOG_ERROR("Window creation error: {}", SDL_GetError());
         return;
     }
 
     renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     if (!renderer) {
-        cerr << "Renderer creation error: " << SDL_GetError() << std::endl;
+        LOG_ERROR("Renderer creation error: {}", SDL_GetError());
         return;
     }
-    font = TTF_OpenFont("PressStart2P-Regular.ttf", 24);
+    // Baked on the first run, loaded from font_atlas.bmp/.txt afterwards.
+    if (!fontAtlas.Load(renderer, "PressStart2P-Regular.ttf", {WIN_TEXT_SIZE, HUD_TEXT_SIZE})) {
+        LOG_ERROR("Font atlas unavailable, text disabled");
+    }
     LoadLevelConfiguration("level_config.txt");
     LoadTextures();
+    if (Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048) < 0) {
+        LOG_ERROR("SDL_mixer initialization error: {}", Mix_GetError());
+    } else {
+        LoadSounds();
+    }
     isRunning = true;
 }
 
 void GameEngine::Run() {
-    cout << "Run";
+    LOG_INFO("Run");
+    if (!isRunning) {
+        return;
+    }
+    // The render thread's own copy; shares no rows with the simulation's.
+    renderLevel = level.Clone();
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        renderAutotile[layer].Build(renderLevel.layers[layer]);
+    }
+    CreateLayerTargets();
+    runStartTicks = fpsWindowStart = SDL_GetTicks64();
+    SubscribeEvents();
+    PublishSnapshot();
+    simThread = thread(&GameEngine::SimulationLoop, this);
+
+    scenes.SetPolicy(SCENE_PLAYING, {false, PLAY_FPS_CAP, 0});
+    scenes.SetPolicy(SCENE_WON, {true, WIN_FPS_CAP, IDLE_TIMEOUT_MS});
+    scenes.SetPolicy(SCENE_LOST, {true, WIN_FPS_CAP, LOSE_SCREEN_MS});
+
+    // Render thread: owns the window, the event queue and the renderer, and
+    // only ever looks at the latest published snapshot.
     while (isRunning) {
-        if (won) {
-            win();
+        scenes.WaitForNextFrame();
+        events.Drain();
+        // The view does not scroll, so the camera sits at the screen centre.
+        // Channel-pool voices start in sfx.Update(), so positions go first.
+        positional.Update(SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f);
+        sfx.Update();
+        TileChange change;
+        while (tileChanges.TryPop(change)) {
+            TileGrid& grid = renderLevel.layers[change.layer];
+            layerTiles[change.layer] += (TileAtlas::InGame(change.type) ? 1 : 0) - (TileAtlas::InGame(grid.Get(change.x, change.y)) ? 1 : 0);
+            grid.Set(change.x, change.y, change.type);
+            vector<SDL_Point>& dirty = layerDirty[change.layer];
+            renderAutotile[change.layer].Update(grid, change.x, change.y, [&dirty](int x, int y) { dirty.push_back({x, y}); });
+        }
+        snapshots.Consume();
+        const WorldSnapshot& snap = snapshots.Front();
+        if (snap.outcome != OUTCOME_PLAYING && scenes.Scene() == SCENE_PLAYING) {
+            runEndTicks = SDL_GetTicks64();
+        }
+        scenes.SetScene(snap.outcome == OUTCOME_LOST ? SCENE_LOST : snap.outcome == OUTCOME_WON ? SCENE_WON : SCENE_PLAYING);
+        if (scenes.Scene() == SCENE_WON) {
             SDL_Event e;
             while (SDL_PollEvent(&e) != 0) {
                 if (e.type == SDL_QUIT || e.type == SDL_KEYDOWN) {
                     isRunning = false;
                 }
             }
+        } else if (scenes.Scene() == SCENE_LOST) {
+            // The simulation has already stopped; the last frame stays up
+            // for a moment and then the game ends.
+            SDL_Event e;
+            while (SDL_PollEvent(&e) != 0) {
+                if (e.type == SDL_QUIT) {
+                    isRunning = false;
+                }
+            }
+            if (SDL_GetTicks64() - runEndTicks >= LOSE_SCREEN_MS) {
+                isRunning = false;
+            }
         } else {
             handleInput();
-            Update();
-            RenderScene();
+        }
+        if (scenes.NeedsRender()) {
+            RenderScene(snap);
+            if (scenes.Scene() == SCENE_WON) {
+                DrawEndScreen("Congratulations!!! You won!!!");
+            } else if (scenes.Scene() == SCENE_LOST) {
+                DrawEndScreen("Game over");
+            }
+            Render();
+            scenes.FrameRendered();
         }
     }
+    simThread.join();
+    events.Drain();
+    LOG_INFO("Deaths {}, respawns {}, jumps {}", stats.deaths, stats.respawns, stats.jumps);
+    SfxStats sfxStats = sfx.Stats();
+    LOG_INFO("Sounds played {}, stolen {}, rate limited {}, dropped {}", sfxStats.played, sfxStats.stolen, sfxStats.limited, sfxStats.dropped);
+    LOG_INFO("Music underruns {}", music.Underruns());
+    const PositionalStats& posStats = positional.Stats();
+    LOG_INFO("Positional sounds started {}, culled {}, updates {}", posStats.started, posStats.culled, posStats.updated);
+    LOG_INFO("Substepped {} of {} ticks ({} substeps)", substepStats.substeppedTicks, substepStats.ticks, substepStats.substeps);
+}
 
+void GameEngine::SimulationLoop() {
+    const Uint64 frequency = SDL_GetPerformanceFrequency();
+    const Uint64 tickLength = frequency * SIM_TICK_MS / 1000;
+    Uint64 nextTick = SDL_GetPerformanceCounter();
+    while (isRunning && !won && !lost) {
+        PollLiveLink();
+        Update();
+        PublishSnapshot();
+        nextTick += tickLength;
+        Uint64 now = SDL_GetPerformanceCounter();
+        if (nextTick > now) {
+            SDL_Delay(static_cast<Uint32>((nextTick - now) * 1000 / frequency));
+        } else {
+            // Fell behind; drop the backlog instead of spiralling.
+            nextTick = now;
+        }
+    }
 }
 
-void GameEngine::Shutdown() {
-    cout << "Shutdown";
-    if (renderer) {
-        SDL_DestroyRenderer(renderer);
+// Subscribers run on the render thread when Run() drains the bus.
+void GameEngine::SubscribeEvents() {
+    events.Subscribe(EVENT_DEATH, [this](const GameEvent& e) {
+        stats.deaths++;
+        if (e.value == 0) {
+            LOG_INFO("PermaDeath");
+        } else {
+            LOG_INFO("Death, {} lives left", e.value);
+        }
+    });
+    events.Subscribe(EVENT_RESPAWN, [this](const GameEvent&) {
+        stats.respawns++;
+    });
+    events.Subscribe(EVENT_JUMP, [this](const GameEvent&) {
+        stats.jumps++;
+    });
+
+    // Audio
+    events.Subscribe(EVENT_JUMP, [this](const GameEvent& e) { PlaySound(jumpSound, e.x, e.y); });
+    events.Subscribe(EVENT_LAND, [this](const GameEvent& e) { PlaySound(landSound, e.x, e.y); });
+    events.Subscribe(EVENT_DEATH, [this](const GameEvent& e) { PlaySound(deathSound, e.x, e.y); });
+    events.Subscribe(EVENT_WIN, [this](const GameEvent& e) { PlaySound(winSound, e.x, e.y); });
+}
+
+// Priorities decide who loses a channel when all of them are busy; the
+// intervals keep a burst of identical events from stacking up. A missing
+// .wav falls back to the synthesized version of the effect.
+void GameEngine::LoadSounds() {
+    sfx.Open(SFX_CHANNELS);
+    jumpSound = sfx.Load("jump.wav", SynthJump(), 1, 50, 4);
+    landSound = sfx.Load("land.wav", SynthLand(), 0, 50, 4);
+    deathSound = sfx.Load("death.wav", SynthDeath(), 2, 250, 1);
+    winSound = sfx.Load("win.wav", SynthWin(), 3, 1000, 1);
+
+    // The soft mixer always carries the streamed music and, when enabled,
+    // keeps its own float copy of every effect.
+    bool mixerReady = softMixer.Open();
+    if (softMixerEnabled && mixerReady) {
+        for (int id : {jumpSound, landSound, deathSound, winSound}) {
+            if (id >= 0) {
+                softSoundOf.resize(id + 1, -1);
+                softSoundOf[id] = softMixer.AddChunk(sfx.Chunk(id));
+            }
+        }
+    }
+    mixerReady = mixerReady && softMixer.Attach();
+    softMixerEnabled = softMixerEnabled && mixerReady;
+    if (!softMixerEnabled) {
+        positional.SetMixer(sfx);
     }
+    if (mixerReady) {
+        music.Open("bgmusic.mp3", softMixer.Frequency(), true);
+        softMixer.AddStream(&music, 0.5f);
+    }
+    LOG_INFO("Sound effects via {}", softMixerEnabled ? "soft mixer" : "SDL_mixer channels");
+}
 
-    if (window) {
-        SDL_DestroyWindow(window);
+// x/y are world pixels. PositionalAudio culls, attenuates and pans the
+// sound for whichever mixer plays effects.
+void GameEngine::PlaySound(int sound, int x, int y) {
+    if (softMixerEnabled) {
+        sound = sound >= 0 && sound < static_cast<int>(softSoundOf.size()) ? softSoundOf[sound] : -1;
+    }
+    if (sound >= 0) {
+        positional.Play(sound, static_cast<float>(x), static_cast<float>(y));
     }
-    TTF_Quit();
-    SDL_Quit();
 }
 
-int GameEngine::checkCollision(int choice = 0) {
-    int X, Y;
-    switch (choice) {
-        case 0 :
-        X = py.x/TILE_SIZE;
-        Y = py.y/TILE_SIZE;
-        break;
-        case 1 :
-        X = py.x/TILE_SIZE;
-        Y = py.y/TILE_SIZE + 1;
-        break;
-        case 2 :
-        X = py.x/TILE_SIZE;
-        Y = py.y/TILE_SIZE - 1;
-        break;
-        case 3 :
-        X = py.x/TILE_SIZE + 1;
-        Y = py.y/TILE_SIZE;
-        break;
-        case 4 : 
-        X = py.x/TILE_SIZE - 1;
-        Y = py.y/TILE_SIZE;
-        break;
-        case 5:
-        X = py.x/TILE_SIZE + 1;
-        Y = py.y/TILE_SIZE - 1;
-        default :
-        case 6:
-        X = py.x/TILE_SIZE + 1;
-        Y = py.y/TILE_SIZE + 1;
-        break;
-    } 
-    if (X >= 0 && X < levelData[0].size() && Y >= 0 && Y < levelData.size()) {
-        if (levelData[Y][X] == 1 || levelData[Y][X] == 2) {
-            return 1;
-        } else {
-            return 0;
-        }
+void GameEngine::PublishSnapshot() {
+    WorldSnapshot& snap = snapshots.Back();
+    snap.playerX = py.x.FloorToInt();
+    snap.playerY = py.y.FloorToInt();
+    snap.lives = py.lives;
+    snap.score = bestColumn * 10;
+    snap.outcome = lost ? OUTCOME_LOST : won ? OUTCOME_WON : OUTCOME_PLAYING;
+    snapshots.Publish();
+    size_t sent = 0;
+    while (sent < pendingTiles.size() && tileChanges.TryPush(pendingTiles[sent])) {
+        ++sent;
     }
-    return -1;
+    pendingTiles.erase(pendingTiles.begin(), pendingTiles.begin() + sent);
 }
 
-void GameEngine::Update() {
-    int flag;
-    if (left) {
-        if (py.x / TILE_SIZE > 0.5) {
-            py.x -= py.SPEED;
-            flag = checkCollision();
-            if (flag == 1) {
-                py.x = ((py.x + TILE_SIZE)/TILE_SIZE) * TILE_SIZE;
-            }
+// Applies edits published by the level editor since the last tick; the
+// editor may start after the game, so a missing link is retried now and then.
+void GameEngine::PollLiveLink() {
+    if (!liveLink.Connected()) {
+        if (--liveLinkRetry > 0) {
+            return;
+        }
+        liveLinkRetry = LIVE_LINK_RETRY_TICKS;
+        if (!liveLink.Open()) {
+            return;
         }
+        LOG_INFO("Live link to level editor connected");
     }
-    if (right) {
-        if (py.x / TILE_SIZE != levelData[0].size() - 1) {
-            py.x += py.SPEED;
-            if (checkCollision(3) == 1) {
-                py.x = (py.x/TILE_SIZE) * TILE_SIZE;
+    // A fill can change thousands of tiles in one poll; one event for all of
+    // them keeps the bus from overflowing and dropping other events.
+    int changed = 0, minX = level.Width(), minY = level.Height();
+    liveLink.Poll([&](int layer, int x, int y, int type) {
+        if (layer >= 0 && layer < LAYER_COUNT && level.Contains(x, y) && level.layers[layer].Get(x, y) != type) {
+            SetTile(layer, x, y, type);
+            if (layer == LAYER_COLLISION) {
+                ++changed;
+                minX = x < minX ? x : minX;
+                minY = y < minY ? y : minY;
             }
         }
+    });
+    if (changed > 0) {
+        events.Emit(EVENT_TILE_CHANGED, minX, minY, changed);
     }
+}
 
-    
-    if (isJumping) velocityY += 1;
-    py.y += velocityY;
+// Only collision edits are gameplay events; visual layers just get redrawn.
+void GameEngine::SetTile(int layer, int x, int y, int type) {
+    level.layers[layer].Set(x, y, type);
+    pendingTiles.push_back({layer, x, y, type});
+    if (layer == LAYER_COLLISION) {
+        solids.Set(x, y, IsSolidTile(type));
+    }
+}
 
-    if (velocityY > 0 && (checkCollision(1) == 1 || checkCollision(6) == 1)) {
-        
-        py.y = (py.y/ TILE_SIZE) * TILE_SIZE;
-        velocityY = 0;
-        isJumping = false;
+void GameEngine::Shutdown() {
+    LOG_INFO("Shutdown");
+    fontAtlas.Release();
+    tileAtlas.Destroy();
+    for (SDL_Texture*& target : layerTargets) {
+        if (target) {
+            SDL_DestroyTexture(target);
+            target = nullptr;
+        }
+    }
+    softMixer.Detach();
+    music.Close();
+    sfx.Shutdown();
+    Mix_CloseAudio();
+    if (renderer) {
+        SDL_DestroyRenderer(renderer);
+        renderer = nullptr;
     }
 
-    if (jump && !isJumping) {
-        isJumping = true;
-        velocityY -= py.JUMP_VELOCITY;
+    if (window) {
+        SDL_DestroyWindow(window);
+        window = nullptr;
     }
+    TTF_Quit();
+    SDL_Quit();
+}
+
+void GameEngine::SetSubstepping(Fixed maxStep, int maxSubsteps) {
+    substepConfig.maxStep = maxStep > Fixed() ? maxStep : DEFAULT_MAX_STEP;
+    substepConfig.maxSubsteps = maxSubsteps > 0 ? maxSubsteps : 1;
+}
 
-    if (velocityY <= 0 && checkCollision() == 1) {
-        py.y = ((py.y + TILE_SIZE)/TILE_SIZE) * TILE_SIZE;
-        velocityY = 0;
+void GameEngine::Update() {
+    PlayerBody body = {py.x, py.y, velocityY, isJumping};
+    const PlayerInput input = {left, right, jump};
+    const PlayerTuning tuning = {py.SPEED, py.JUMP_VELOCITY, GRAVITY, TILE_SIZE};
+    const PlayerStep step = StepPlayer(body, input, tuning, substepConfig, solids, substepStats);
+    py.x = body.x;
+    py.y = body.y;
+    velocityY = body.velocityY;
+    isJumping = body.jumping;
+    if (step.landed) {
+        events.Emit(EVENT_LAND, step.landX.FloorToInt(), step.landY.FloorToInt(), 0);
     }
-    if (velocityY == 0 && checkCollision() != 1) {
-        isJumping = true;
+    if (step.jumped) {
+        events.Emit(EVENT_JUMP, step.jumpX.FloorToInt(), step.jumpY.FloorToInt(), 0);
     }
-    if (py.y > SCREEN_HEIGHT + 50) {
-        cout << "Death";
+
+    if (py.y > Fixed::FromInt(SCREEN_HEIGHT + 50)) {
         py.lives--;
+        events.Emit(EVENT_DEATH, py.x.FloorToInt(), py.y.FloorToInt(), py.lives);
         if (py.lives == 0) {
-            cout << "PermaDeath";
-            isRunning = false;
-            SDL_Delay(1000);
-        } else {
-            py.x = startX;
-            py.y = startY;
+            // The simulation stops here; the render thread shows the end.
+            lost = true;
+            return;
         }
+        py.x = Fixed::FromInt(startX);
+        py.y = Fixed::FromInt(startY);
+        events.Emit(EVENT_RESPAWN, startX, startY, py.lives);
+    }
+    if (TileOf(py.x) > bestColumn) {
+        bestColumn = TileOf(py.x);
     }
     if (winCheck()) {
         won = true;
+        events.Emit(EVENT_WIN, py.x.FloorToInt(), py.y.FloorToInt(), py.lives);
     }
 }
 
@@ -236,6 +547,13 @@ void GameEngine::handleInput() {
     while (SDL_PollEvent(&event) != 0) {
         if (event.type == SDL_QUIT) {
             isRunning = false;
+        } else if (event.type == SDL_RENDER_TARGETS_RESET) {
+            // The layer targets lost their contents.
+            for (bool& redraw : layerFullRedraw) {
+                redraw = true;
+            }
+        } else if (event.type == SDL_RENDER_DEVICE_RESET) {
+            CreateLayerTargets();
         } else if (event.type == SDL_KEYDOWN) {
             switch (event.key.keysym.sym) {
                 case SDLK_ESCAPE:
@@ -272,75 +590,88 @@ void GameEngine::handleInput() {
 }
 
 void GameEngine::LoadTextures() {
-    SDL_Surface* tileSurface = IMG_Load("soil.png");
-    tileTexture[1] = SDL_CreateTextureFromSurface(renderer, tileSurface);
-    SDL_FreeSurface(tileSurface);
-
-
-    SDL_Surface* tileSurface2 = IMG_Load("grass.png");
-    tileTexture[2] = SDL_CreateTextureFromSurface(renderer, tileSurface2);
-    SDL_FreeSurface(tileSurface2);
-
-
-    SDL_Surface* playerSurface = IMG_Load("playerpic2.png");
-    playerTexture = SDL_CreateTextureFromSurface(renderer, playerSurface);
-    SDL_FreeSurface(playerSurface);
-
-
-    SDL_Surface* backg = IMG_Load("bg3.png");
-    bg = SDL_CreateTextureFromSurface(renderer, backg);
-    SDL_FreeSurface(backg);
-
-
-    SDL_Surface* fgSur = IMG_Load("flag.png");
-    fg = SDL_CreateTextureFromSurface(renderer, fgSur);
-    SDL_FreeSurface(fgSur);
-    
-
-    SDL_Surface* lifeactive=IMG_Load("lifeActive.png");
-    Life[6] = SDL_CreateTextureFromSurface(renderer,lifeactive);
-    SDL_FreeSurface(lifeactive);
+    // Images are decoded on the job system; textures can only be created on
+    // the thread that owns the renderer, so that part stays here. The tile
+    // images go into the atlas shared with the level editor.
+    const char* paths[] = {"playerpic2.png", "bg3.png", "lifeActive.png", "lifeInactive.png"};
+    const int count = sizeof(paths) / sizeof(paths[0]);
+    SDL_Surface* surfaces[count] = {};
+    SDL_Surface* tileImages[TILE_TYPES] = {};
+    jobs.ParallelFor(0, TILE_TYPES, 1, [&tileImages](size_t begin, size_t end) {
+        for (size_t type = begin; type < end; ++type) {
+            if (TILE_ART[type].image) {
+                tileImages[type] = IMG_Load(TILE_ART[type].image);
+            }
+        }
+    });
+    jobs.ParallelFor(0, count, 1, [&paths, &surfaces](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            surfaces[i] = IMG_Load(paths[i]);
+        }
+    });
 
+    SDL_Texture* textures[count];
+    for (int i = 0; i < count; ++i) {
+        if (!surfaces[i]) {
+            LOG_ERROR("Failed to load {}: {}", paths[i], IMG_GetError());
+        }
+        textures[i] = SDL_CreateTextureFromSurface(renderer, surfaces[i]);
+        SDL_FreeSurface(surfaces[i]);
+    }
 
-    SDL_Surface* lifeInactive = IMG_Load("lifeInactive.png");
-    Life[7] = SDL_CreateTextureFromSurface(renderer,lifeInactive);
-    SDL_FreeSurface(lifeInactive);
+    playerTexture = textures[0];
+    bg = textures[1];
+    Life[6] = textures[2];
+    Life[7] = textures[3];
+    if (!tileAtlas.Build(renderer, tileImages)) {
+        LOG_ERROR("Tile atlas unavailable, tiles will not be drawn");
+    }
+    for (SDL_Surface* image : tileImages) {
+        SDL_FreeSurface(image);
+    }
 }
 
 void GameEngine::LoadLevelConfiguration(const std::string& configFile) {
-    ifstream inFile(configFile);
-
-    levelData.clear(); 
-    int tileType;
-    string line;
-    while (getline(inFile, line, '\n')) {
-        vector<int> tileRow;
-        istringstream ss(line);
-        while (ss >> tileType) {
-            tileRow.push_back(tileType);
-        }
-        levelData.push_back(tileRow);
+    if (!ReadLevel(configFile, level)) {
+        LOG_ERROR("Could not read {}", configFile);
     }
+    // The spawn search and the screen assume at least one screen of level.
+    if (level.Width() < SCREEN_WIDTH / TILE_SIZE || level.Height() < SCREEN_HEIGHT / TILE_SIZE) {
+        level = level.Cropped(0, 0, max(level.Width(), SCREEN_WIDTH / TILE_SIZE), max(level.Height(), SCREEN_HEIGHT / TILE_SIZE));
+    }
+    solids.Build(level.Collision());
 
-    inFile.close();
-
+    const TileGrid& collision = level.Collision();
     for (int i = 0; i < SCREEN_HEIGHT/TILE_SIZE; i++) {
         for (int j = 0; j < SCREEN_WIDTH/TILE_SIZE; j++) {
-            std::cout << levelData[i][j] << " ";
-            if (levelData[i][j] == 5) {
-                py.x = startX = j*TILE_SIZE;
-                py.y = startY = i*TILE_SIZE;
+            if (collision.Get(j, i) == 5) {
+                startX = j*TILE_SIZE;
+                startY = i*TILE_SIZE;
+                py.x = Fixed::FromInt(startX);
+                py.y = Fixed::FromInt(startY);
             }
         }
-        cout << std::endl;
     }
+    LOG_INFO("Loaded {}: {}x{}, visual layers {}, spawn at {},{}", configFile, level.Width(), level.Height(),
+             level.HasVisualLayers() ? "yes" : "no", startX, startY);
+#if LOG_LEVEL <= LOG_LEVEL_DEBUG
+    for (int y = 0; y < collision.Height(); ++y) {
+        const vector<int>& row = collision.Row(y);
+        string text;
+        for (int tile : row) {
+            text += to_string(tile);
+            text += ' ';
+        }
+        LOG_DEBUG("{}", text);
+    }
+#endif
 }
 
 bool GameEngine::winCheck() {
-    int X = py.x/TILE_SIZE;
-    int Y = py.y/TILE_SIZE;
-    if (X >= 0 && X < levelData[0].size() && Y >= 0 && Y < levelData.size()) {
-        if (levelData[Y][X] == 3) {
+    int X = TileOf(py.x);
+    int Y = TileOf(py.y);
+    if (level.Contains(X, Y)) {
+        if (level.Collision().Get(X, Y) == 3) {
             return true;
         } else {
             return false;
@@ -349,53 +680,54 @@ bool GameEngine::winCheck() {
     return false;
 }
 
-void GameEngine::win() {
+void GameEngine::DrawEndScreen(const char* message) {
     SDL_Rect menuRect = {SCREEN_WIDTH / 4, SCREEN_HEIGHT / 4, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2};
     SDL_SetRenderDrawColor(renderer, 128, 128, 128, 255);
     SDL_RenderFillRect(renderer, &menuRect);
     SDL_Color col = {255, 255, 255, 255};
-    SDL_Surface* textSurface = TTF_RenderText_Solid(font, "Congratulations!!! You won!!!", col);
-    tt = SDL_CreateTextureFromSurface(renderer, textSurface);
-    SDL_Rect textRect = {SCREEN_WIDTH / 2 - 90, SCREEN_HEIGHT / 2 + 45, 180, 30};
-    SDL_RenderCopy(renderer, tt, nullptr, &textRect);
-    SDL_FreeSurface(textSurface);
-    SDL_RenderPresent(renderer);
+    text.Draw(message, (SCREEN_WIDTH - text.Measure(message, WIN_TEXT_SIZE)) / 2, SCREEN_HEIGHT / 2 + 45, WIN_TEXT_SIZE, col);
+    text.Flush(renderer);
+}
+
+// Score, run time and FPS, redrawn every frame from the font atlas without
+// creating any surfaces or textures.
+void GameEngine::DrawHud(const WorldSnapshot& snap) {
+    Uint64 now = SDL_GetTicks64();
+    framesThisWindow++;
+    if (now - fpsWindowStart >= 1000) {
+        fps = static_cast<int>(framesThisWindow * 1000 / (now - fpsWindowStart));
+        framesThisWindow = 0;
+        fpsWindowStart = now;
+    }
+    Uint64 elapsed = (runEndTicks ? runEndTicks : now) - runStartTicks;
+
+    char line[64];
+    snprintf(line, sizeof(line), "SCORE %05d  TIME %02d:%02d.%02d  FPS %d", snap.score,
+             static_cast<int>(elapsed / 60000), static_cast<int>(elapsed / 1000 % 60), static_cast<int>(elapsed / 10 % 100), fps);
+    SDL_Color col = {255, 255, 255, 255};
+    text.Draw(line, 8, 8, HUD_TEXT_SIZE, col);
+    text.Flush(renderer);
 }
 
-void GameEngine::RenderScene() {
+void GameEngine::RenderScene(const WorldSnapshot& snap) {
     int lifeFlag[3] = {1, 1, 1};
     SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
     SDL_RenderClear(renderer);
     SDL_Rect backGround = {0, 0, SCREEN_WIDTH, SCREEN_HEIGHT};
     SDL_RenderCopy(renderer, bg, nullptr, &backGround);
-    for (int y = 0; y < levelData.size(); ++y) {
-        for (int x = 0; x < levelData[y].size(); ++x) {
-            SDL_Rect tileRect = {(x * TILE_SIZE), (y * TILE_SIZE), TILE_SIZE, TILE_SIZE};
-            switch (levelData[y][x]) {
-                case 0:
-                    break;
-                case 1:
-                    SDL_RenderCopy(renderer, tileTexture[1], nullptr, &tileRect);
-                    break;
-                case 2:
-                    SDL_RenderCopy(renderer, tileTexture[2], nullptr, &tileRect);
-                    break;
-                case 3:
-                    SDL_RenderCopy(renderer, fg, nullptr, &tileRect);
-                    break;
-                case 4:
-                    SDL_SetRenderDrawColor(renderer, 0, 0, 160, 255);
-                    SDL_RenderFillRect(renderer, &tileRect);
-                case 5:
-                    break;
-                default:
-                    break;
-            }
+
+    UpdateLayerTargets();
+    for (LevelLayer layer : LAYER_DRAW_ORDER) {
+        if (layer != LAYER_FOREGROUND) {
+            DrawLayer(layer);
         }
     }
-    if (py.lives == 2) {
+    SDL_Rect PlayerRect = {snap.playerX, snap.playerY, TILE_SIZE, TILE_SIZE};
+    SDL_RenderCopy(renderer, playerTexture, nullptr, &PlayerRect);
+    DrawLayer(LAYER_FOREGROUND);
+    if (snap.lives == 2) {
         lifeFlag[0] = 0;
-    } else if (py.lives == 1) {
+    } else if (snap.lives == 1) {
         lifeFlag[0] = lifeFlag[1] = 0;
     }
     for (int i = 0; i < 3; i++) {
@@ -405,10 +737,84 @@ void GameEngine::RenderScene() {
         SDL_Rect tRect = {X, Y, TILE_SIZE, TILE_SIZE};
         SDL_RenderCopy(renderer, lt, nullptr, &tRect);
     }
-    SDL_Rect PlayerRect = {py.x, py.y, TILE_SIZE, TILE_SIZE};
-    SDL_RenderCopy(renderer, playerTexture, nullptr, &PlayerRect);
-    SDL_RenderPresent(renderer);
-    SDL_Delay(8);
+    DrawHud(snap);
+}
+
+void GameEngine::CreateLayerTargets() {
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        if (layerTargets[layer]) {
+            SDL_DestroyTexture(layerTargets[layer]);
+        }
+        layerTargets[layer] = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+        if (!layerTargets[layer]) {
+            LOG_ERROR("Could not create {} layer target: {}", LAYER_NAMES[layer], SDL_GetError());
+            continue;
+        }
+        SDL_SetTextureBlendMode(layerTargets[layer], SDL_BLENDMODE_BLEND);
+        layerFullRedraw[layer] = true;
+    }
+}
+
+// Brings every layer target up to date with renderLevel: the whole layer
+// after a reset, otherwise just the tiles changed since the last frame.
+// Only the part of the level on screen is drawn, the view does not scroll.
+void GameEngine::UpdateLayerTargets() {
+    const int columns = min(renderLevel.Width(), SCREEN_WIDTH / TILE_SIZE + 1);
+    const int rows = min(renderLevel.Height(), SCREEN_HEIGHT / TILE_SIZE + 1);
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        SDL_Texture* target = layerTargets[layer];
+        vector<SDL_Point>& dirty = layerDirty[layer];
+        if (!target || (!layerFullRedraw[layer] && dirty.empty())) {
+            dirty.clear();
+            continue;
+        }
+        const TileGrid& grid = renderLevel.layers[layer];
+        const Autotiler& autotile = renderAutotile[layer];
+        SDL_SetRenderTarget(renderer, target);
+        SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+        if (layerFullRedraw[layer]) {
+            SDL_RenderClear(renderer);
+            layerTiles[layer] = 0;
+            for (int y = 0; y < rows; ++y) {
+                const vector<int>& row = grid.Row(y);
+                for (int x = 0; x < columns; ++x) {
+                    if (TileAtlas::InGame(row[x])) {
+                        SDL_Rect rect = {x * TILE_SIZE, y * TILE_SIZE, TILE_SIZE, TILE_SIZE};
+                        tileAtlas.DrawTile(renderer, row[x], autotile.Variant(x, y), rect);
+                    }
+                }
+            }
+            // Counted over the whole layer, like the incremental updates.
+            for (int y = 0; y < grid.Height(); ++y) {
+                for (int type : grid.Row(y)) {
+                    layerTiles[layer] += TileAtlas::InGame(type) ? 1 : 0;
+                }
+            }
+            layerFullRedraw[layer] = false;
+        } else {
+            for (const SDL_Point& p : dirty) {
+                if (p.x >= columns || p.y >= rows) {
+                    continue;
+                }
+                SDL_Rect rect = {p.x * TILE_SIZE, p.y * TILE_SIZE, TILE_SIZE, TILE_SIZE};
+                SDL_RenderFillRect(renderer, &rect);
+                const int type = grid.Get(p.x, p.y);
+                if (TileAtlas::InGame(type)) {
+                    tileAtlas.DrawTile(renderer, type, autotile.Variant(p.x, p.y), rect);
+                }
+            }
+        }
+        dirty.clear();
+    }
+    SDL_SetRenderTarget(renderer, nullptr);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+}
+
+void GameEngine::DrawLayer(int layer) {
+    if (layerTargets[layer] && layerTiles[layer] > 0) {
+        SDL_RenderCopy(renderer, layerTargets[layer], nullptr, nullptr);
+    }
 }
 
 void GameEngine::Render() {
@@ -417,6 +823,11 @@ void GameEngine::Render() {
 
 int main(int argc, char** argv) {
     GameEngine game;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--soft-mixer") == 0) {
+            game.UseSoftMixer(true);
+        }
+    }
     game.Initialize("Game Engine", SCREEN_WIDTH, SCREEN_HEIGHT);
     game.Run();
     game.Shutdown();
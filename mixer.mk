@@ -0,0 +1,5 @@
+mixerBench:
+	g++ -O2 -I src/include -L src/lib -o mixerBench mixerBench.cpp -lSDL2_mixer -lSDL2
+
+musicStreamTest:
+	g++ -O2 -pthread -I src/include -L src/lib -o musicStreamTest musicStreamTest.cpp -lSDL2
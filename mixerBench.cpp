@@ -0,0 +1,79 @@
+#define SDL_MAIN_HANDLED
+#include "softMixer.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+// Offline benchmark for softMixer.h: no audio device is opened. Mixes the
+// requested number of looping voices block by block, converts each block to
+// signed 16-bit stereo like the post-mix hook does, and reports how much CPU
+// time one millisecond of audio costs, with and without SSE.
+
+static const int SAMPLE_RATE = 44100;
+static const int BLOCK = 512;
+
+static double runMix(int voices, int seconds, bool simd) {
+    SoftMixer mixer;
+    mixer.SetSimd(simd);
+    // A few sounds of different lengths so voices wrap at different points.
+    for (int s = 0; s < 8; ++s) {
+        shared_ptr<SoftSound> sound(new SoftSound());
+        sound->samples.resize(SAMPLE_RATE / 4 + s * 997);
+        for (size_t i = 0; i < sound->samples.size(); ++i) {
+            sound->samples[i] = 0.5f * std::sin(i * (0.01f + s * 0.003f));
+        }
+        mixer.AddSound(sound);
+    }
+    vector<float> mix(BLOCK * 2);
+    vector<Sint16> device(BLOCK * 2);
+    // The command ring only holds so many entries, so start voices in batches.
+    for (int started = 0; started < voices;) {
+        int batch = voices - started < 512 ? voices - started : 512;
+        for (int v = 0; v < batch; ++v, ++started) {
+            mixer.Play(started % 8, 1.0f / voices, (started % 21) / 10.0f - 1.0f, true);
+        }
+        mixer.Mix(mix.data(), BLOCK);
+    }
+
+    long long frames = static_cast<long long>(SAMPLE_RATE) * seconds;
+    auto start = chrono::steady_clock::now();
+    for (long long done = 0; done < frames; done += BLOCK) {
+        mixer.Mix(mix.data(), BLOCK);
+        fill(device.begin(), device.end(), Sint16(0));
+        AddFloatToS16(mix.data(), device.data(), BLOCK * 2, simd);
+    }
+    chrono::duration<double, milli> elapsed = chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+int main(int argc, char** argv) {
+    int maxVoices = argc > 1 ? atoi(argv[1]) : SoftMixer::MAX_VOICES;
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    if (maxVoices > SoftMixer::MAX_VOICES) {
+        maxVoices = SoftMixer::MAX_VOICES;
+    }
+    double audioMs = seconds * 1000.0;
+
+    cout << "voices  path    cpu ms   cpu us/audio ms   voices per audio ms" << endl;
+    for (int voices = 16; voices <= maxVoices; voices *= 2) {
+        for (int pass = 0; pass < 2; ++pass) {
+            bool simd = pass == 0;
+#ifndef SOFT_MIXER_SSE2
+            if (simd) {
+                continue;
+            }
+#endif
+            double cpuMs = runMix(voices, seconds, simd);
+            // How many voices one audio millisecond's worth of CPU could mix.
+            double perMs = voices * audioMs / cpuMs;
+            cout << voices << "\t" << (simd ? "sse2" : "scalar") << "\t" << cpuMs << "\t"
+                 << cpuMs * 1000.0 / audioMs << "\t\t" << perMs << endl;
+        }
+    }
+    return 0;
+}
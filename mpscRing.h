@@ -0,0 +1,67 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for many producers and a single consumer. Storage
+// is a fixed array, so pushing never allocates; a full ring makes TryPush
+// fail instead of blocking. Each slot carries a sequence number that tells
+// producers and the consumer whose turn it is (Vyukov's bounded queue).
+template <typename T, size_t Capacity>
+class MpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    MpscRing() : head(0), tail(0) {
+        for (size_t i = 0; i < Capacity; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Any thread.
+    bool TryPush(const T& value) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots[pos & (Capacity - 1)];
+            size_t seq = slot.sequence.load(std::memory_order_acquire);
+            ptrdiff_t diff = static_cast<ptrdiff_t>(seq - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Consumer thread only.
+    bool TryPop(T& out) {
+        Slot& slot = slots[head & (Capacity - 1)];
+        size_t seq = slot.sequence.load(std::memory_order_acquire);
+        if (static_cast<ptrdiff_t>(seq - (head + 1)) < 0) {
+            return false;
+        }
+        out = slot.value;
+        slot.sequence.store(head + Capacity, std::memory_order_release);
+        ++head;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Slot slots[Capacity];
+    size_t head;
+    alignas(64) std::atomic<size_t> tail;
+};
+
+#endif
@@ -0,0 +1,475 @@
+#ifndef MUSIC_STREAM_H
+#define MUSIC_STREAM_H
+
+#include <SDL2/SDL.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "logger.h"
+#include "softMixer.h"
+
+// Streams a long music track instead of decoding it up front. A background
+// thread reads the file in small pieces, decodes and converts them with
+// SDL_AudioStream to interleaved stereo float at the device rate and pushes
+// the result into a lock-free single-producer/single-consumer ring; the soft
+// mixer drains the ring from the audio callback. Memory stays at roughly
+// RING_MS of PCM no matter how long the track is, and the game thread never
+// touches the file, the decoder or the converter.
+//
+// WAV (8/16/32-bit integer or 32-bit float PCM) is read directly. MP3 is
+// decoded with libmpg123, which SDL_mixer does not expose, so it is loaded
+// at run time the way SDL_mixer loads its optional decoders: nothing extra
+// is needed to build, and without the library (libmpg123-0.dll next to the
+// executable on Windows) MP3 tracks log an error and stay silent.
+
+// Fixed-size ring of float samples. Write() is for the producer thread and
+// Read() for the consumer thread only.
+class PcmRing {
+public:
+    PcmRing() : mask(0), head(0), tail(0) {}
+
+    // Not thread-safe; call before either side starts.
+    void Reset(size_t minSamples) {
+        size_t capacity = 2;
+        while (capacity < minSamples) {
+            capacity <<= 1;
+        }
+        buffer.assign(capacity, 0.0f);
+        mask = capacity - 1;
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+
+    size_t Free() const {
+        return buffer.size() - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+    }
+
+    size_t Write(const float* src, size_t count) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t space = buffer.size() - (t - head.load(std::memory_order_acquire));
+        count = count < space ? count : space;
+        for (size_t i = 0; i < count; ++i) {
+            buffer[(t + i) & mask] = src[i];
+        }
+        tail.store(t + count, std::memory_order_release);
+        return count;
+    }
+
+    size_t Read(float* dst, size_t count) {
+        size_t h = head.load(std::memory_order_relaxed);
+        size_t available = tail.load(std::memory_order_acquire) - h;
+        count = count < available ? count : available;
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = buffer[(h + i) & mask];
+        }
+        head.store(h + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    std::vector<float> buffer;
+    size_t mask;
+    std::atomic<size_t> head;
+    std::atomic<size_t> tail;
+};
+
+// One track's PCM in its own format, read from the start in pieces.
+class MusicDecoder {
+public:
+    MusicDecoder() : format(0), channels(0), rate(0), frameBytes(0) {}
+    virtual ~MusicDecoder() {}
+
+    // Up to size bytes of whole frames; 0 at the end of the track or on a
+    // decode error.
+    virtual size_t Read(Uint8* out, size_t size) = 0;
+    // Back to the first frame, for looping.
+    virtual bool Rewind() = 0;
+
+    SDL_AudioFormat format;
+    int channels;
+    int rate;
+    int frameBytes;
+};
+
+class WavDecoder : public MusicDecoder {
+public:
+    explicit WavDecoder(SDL_RWops* file) : rw(file), dataStart(0), dataBytes(0), remaining(0) {}
+    ~WavDecoder() override { SDL_RWclose(rw); }
+
+    bool Open() {
+        char id[4];
+        if (SDL_RWread(rw, id, 1, 4) != 4 || memcmp(id, "RIFF", 4) != 0) {
+            return false;
+        }
+        SDL_ReadLE32(rw);
+        if (SDL_RWread(rw, id, 1, 4) != 4 || memcmp(id, "WAVE", 4) != 0) {
+            return false;
+        }
+        bool haveFormat = false;
+        while (SDL_RWread(rw, id, 1, 4) == 4) {
+            Uint32 size = SDL_ReadLE32(rw);
+            Sint64 next = SDL_RWtell(rw) + size + (size & 1);
+            if (memcmp(id, "fmt ", 4) == 0 && size >= 16) {
+                Uint16 tag = SDL_ReadLE16(rw);
+                channels = SDL_ReadLE16(rw);
+                rate = static_cast<int>(SDL_ReadLE32(rw));
+                SDL_ReadLE32(rw);
+                frameBytes = SDL_ReadLE16(rw);
+                Uint16 bits = SDL_ReadLE16(rw);
+                if (tag == 0xFFFE && size >= 26) {
+                    SDL_ReadLE16(rw);
+                    SDL_ReadLE16(rw);
+                    SDL_ReadLE32(rw);
+                    tag = SDL_ReadLE16(rw);
+                }
+                if (tag == 1 && bits == 8) {
+                    format = AUDIO_U8;
+                } else if (tag == 1 && bits == 16) {
+                    format = AUDIO_S16LSB;
+                } else if (tag == 1 && bits == 32) {
+                    format = AUDIO_S32LSB;
+                } else if (tag == 3 && bits == 32) {
+                    format = AUDIO_F32LSB;
+                } else {
+                    return false;
+                }
+                haveFormat = channels > 0 && rate > 0 && frameBytes > 0;
+            } else if (memcmp(id, "data", 4) == 0) {
+                dataStart = SDL_RWtell(rw);
+                dataBytes = remaining = size;
+                return haveFormat;
+            }
+            SDL_RWseek(rw, next, RW_SEEK_SET);
+        }
+        return false;
+    }
+
+    size_t Read(Uint8* out, size_t size) override {
+        size_t chunk = remaining < size ? remaining : size;
+        size_t got = chunk > 0 ? SDL_RWread(rw, out, 1, chunk) : 0;
+        remaining = got > 0 ? remaining - static_cast<Uint32>(got) : 0;
+        return got;
+    }
+
+    bool Rewind() override {
+        remaining = dataBytes;
+        return SDL_RWseek(rw, dataStart, RW_SEEK_SET) == dataStart;
+    }
+
+private:
+    SDL_RWops* rw;
+    Sint64 dataStart;
+    Uint32 dataBytes;
+    Uint32 remaining;
+};
+
+// The libmpg123 entry points Mp3Decoder uses, resolved once on first use.
+// Handles are opaque; the constants are the ones from mpg123.h.
+struct Mpg123Api {
+    enum { OK = 0, NEED_MORE = -10, NEW_FORMAT = -11, DONE = -12 };
+    enum { ADD_FLAGS = 2, FLAG_QUIET = 0x20, ENC_SIGNED_16 = 0xd0, ENC_FLOAT_32 = 0x200 };
+
+    void* library;
+    int (*init)();
+    void* (*create)(const char* decoder, int* error);
+    void (*destroy)(void* handle);
+    int (*param)(void* handle, int type, long value, double fvalue);
+    int (*openFeed)(void* handle);
+    int (*feed)(void* handle, const unsigned char* in, size_t size);
+    int (*decode)(void* handle, const unsigned char* in, size_t inSize, unsigned char* out, size_t outSize, size_t* done);
+    int (*getFormat)(void* handle, long* rate, int* channels, int* encoding);
+
+    // nullptr if the library or one of its functions is missing.
+    static const Mpg123Api* Get() {
+        static const Mpg123Api api = Load();
+        return api.library ? &api : nullptr;
+    }
+
+private:
+    static Mpg123Api Load() {
+#if defined(_WIN32)
+        const char* name = "libmpg123-0.dll";
+#elif defined(__APPLE__)
+        const char* name = "libmpg123.0.dylib";
+#else
+        const char* name = "libmpg123.so.0";
+#endif
+        Mpg123Api api;
+        memset(&api, 0, sizeof(api));
+        void* library = SDL_LoadObject(name);
+        if (!library) {
+            return api;
+        }
+        bool ok = Resolve(library, "mpg123_init", api.init) && Resolve(library, "mpg123_new", api.create) &&
+                  Resolve(library, "mpg123_delete", api.destroy) && Resolve(library, "mpg123_param", api.param) &&
+                  Resolve(library, "mpg123_open_feed", api.openFeed) && Resolve(library, "mpg123_feed", api.feed) &&
+                  Resolve(library, "mpg123_decode", api.decode) && Resolve(library, "mpg123_getformat", api.getFormat);
+        if (!ok || api.init() != OK) {
+            SDL_UnloadObject(library);
+            return api;
+        }
+        api.library = library;
+        return api;
+    }
+
+    template <typename F>
+    static bool Resolve(void* library, const char* name, F& function) {
+        function = reinterpret_cast<F>(SDL_LoadFunction(library, name));
+        return function != nullptr;
+    }
+};
+
+// Feeds the file to libmpg123 a piece at a time and takes whatever PCM it
+// has ready, so only one compressed piece and one MP3 frame are held.
+class Mp3Decoder : public MusicDecoder {
+public:
+    Mp3Decoder(SDL_RWops* file, const Mpg123Api& library) : rw(file), api(library), handle(nullptr), input(READ_BYTES) {}
+    ~Mp3Decoder() override {
+        if (handle) {
+            api.destroy(handle);
+        }
+        SDL_RWclose(rw);
+    }
+
+    bool Open() {
+        int error = 0;
+        handle = api.create(nullptr, &error);
+        if (!handle) {
+            return false;
+        }
+        api.param(handle, Mpg123Api::ADD_FLAGS, Mpg123Api::FLAG_QUIET, 0.0);
+        return Start();
+    }
+
+    size_t Read(Uint8* out, size_t size) override {
+        for (;;) {
+            size_t done = 0;
+            int result = api.decode(handle, nullptr, 0, out, size, &done);
+            if (done > 0) {
+                return done;
+            }
+            if (result == Mpg123Api::NEW_FORMAT) {
+                if (!FormatUnchanged()) {
+                    LOG_ERROR("MP3 changes format mid-stream; stopping");
+                    return 0;
+                }
+            } else if (result == Mpg123Api::NEED_MORE) {
+                if (!Feed()) {
+                    return 0;
+                }
+            } else if (result != Mpg123Api::OK) {
+                return 0;
+            }
+        }
+    }
+
+    bool Rewind() override {
+        SDL_AudioFormat oldFormat = format;
+        int oldChannels = channels, oldRate = rate;
+        return Start() && format == oldFormat && channels == oldChannels && rate == oldRate;
+    }
+
+private:
+    static const size_t READ_BYTES = 4096;
+
+    SDL_RWops* rw;
+    const Mpg123Api& api;
+    void* handle;
+    std::vector<Uint8> input;
+
+    bool Feed() {
+        size_t got = SDL_RWread(rw, input.data(), 1, input.size());
+        return got > 0 && api.feed(handle, input.data(), got) == Mpg123Api::OK;
+    }
+
+    // Restarts at the top of the file and feeds it until the first frame
+    // header gives the output format. A reopened handle whose format has not
+    // changed does not report NEW_FORMAT again, just a frame ready (OK).
+    bool Start() {
+        if (SDL_RWseek(rw, 0, RW_SEEK_SET) != 0 || api.openFeed(handle) != Mpg123Api::OK) {
+            return false;
+        }
+        for (;;) {
+            size_t done = 0;
+            int result = api.decode(handle, nullptr, 0, nullptr, 0, &done);
+            if (result == Mpg123Api::NEW_FORMAT || result == Mpg123Api::OK) {
+                return ReadFormat(format, channels, rate);
+            }
+            if (result != Mpg123Api::NEED_MORE || !Feed()) {
+                return false;
+            }
+        }
+    }
+
+    bool ReadFormat(SDL_AudioFormat& f, int& c, int& r) {
+        long frequency = 0;
+        int encoding = 0;
+        if (api.getFormat(handle, &frequency, &c, &encoding) != Mpg123Api::OK || c <= 0 || frequency <= 0) {
+            return false;
+        }
+        r = static_cast<int>(frequency);
+        if (encoding == Mpg123Api::ENC_SIGNED_16) {
+            f = AUDIO_S16SYS;
+        } else if (encoding == Mpg123Api::ENC_FLOAT_32) {
+            f = AUDIO_F32SYS;
+        } else {
+            return false;
+        }
+        frameBytes = SDL_AUDIO_BITSIZE(f) / 8 * c;
+        return true;
+    }
+
+    bool FormatUnchanged() {
+        SDL_AudioFormat f = 0;
+        int c = 0, r = 0;
+        return ReadFormat(f, c, r) && f == format && c == channels && r == rate;
+    }
+};
+
+// Picks the decoder from the file's first bytes. Logs and returns nullptr
+// if the file is missing or not a supported WAV or MP3.
+inline std::unique_ptr<MusicDecoder> OpenMusicDecoder(const std::string& path) {
+    SDL_RWops* rw = SDL_RWFromFile(path.c_str(), "rb");
+    if (!rw) {
+        LOG_ERROR("Failed to stream music {}: {}", path, SDL_GetError());
+        return nullptr;
+    }
+    char magic[4] = {};
+    bool wav = SDL_RWread(rw, magic, 1, 4) == 4 && memcmp(magic, "RIFF", 4) == 0;
+    SDL_RWseek(rw, 0, RW_SEEK_SET);
+    if (wav) {
+        WavDecoder* wavDecoder = new WavDecoder(rw);
+        std::unique_ptr<MusicDecoder> decoder(wavDecoder);
+        if (wavDecoder->Open()) {
+            return decoder;
+        }
+        LOG_ERROR("Failed to stream music {}: not a supported WAV file", path);
+        return nullptr;
+    }
+    const Mpg123Api* api = Mpg123Api::Get();
+    if (!api) {
+        SDL_RWclose(rw);
+        LOG_ERROR("Failed to stream music {}: libmpg123 is not available", path);
+        return nullptr;
+    }
+    Mp3Decoder* mp3Decoder = new Mp3Decoder(rw, *api);
+    std::unique_ptr<MusicDecoder> decoder(mp3Decoder);
+    if (mp3Decoder->Open()) {
+        return decoder;
+    }
+    LOG_ERROR("Failed to stream music {}: not a WAV or MP3 file", path);
+    return nullptr;
+}
+
+class MusicStream : public MixerStream {
+public:
+    static const int RING_MS = 250;
+
+    MusicStream() : loop(false), deviceRate(0), stopping(false), finished(true), underruns(0) {}
+    ~MusicStream() { Close(); }
+
+    // Starts decoding path on a background thread. deviceRate is the mixer
+    // output rate (SoftMixer::Frequency()).
+    void Open(const std::string& file, int rate, bool looping) {
+        Close();
+        path = file;
+        loop = looping;
+        deviceRate = rate;
+        ring.Reset(static_cast<size_t>(rate) * RING_MS / 1000 * 2);
+        stopping = false;
+        finished = false;
+        decoder = std::thread(&MusicStream::DecodeLoop, this);
+    }
+
+    // The mixer must no longer be reading (SoftMixer::Detach()) before the
+    // stream is destroyed.
+    void Close() {
+        stopping = true;
+        if (decoder.joinable()) {
+            decoder.join();
+        }
+        finished = true;
+    }
+
+    // Audio thread. Returns the frames written to out; an empty ring while
+    // the track is still playing counts as an underrun.
+    int Read(float* out, int frames) override {
+        int got = static_cast<int>(ring.Read(out, static_cast<size_t>(frames) * 2) / 2);
+        if (got < frames && !finished.load(std::memory_order_acquire)) {
+            underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        return got;
+    }
+
+    unsigned long long Underruns() const { return underruns.load(std::memory_order_relaxed); }
+
+private:
+    static const int READ_BYTES = 4096;
+
+    std::string path;
+    bool loop;
+    int deviceRate;
+    PcmRing ring;
+    std::thread decoder;
+    std::atomic<bool> stopping;
+    std::atomic<bool> finished;
+    std::atomic<unsigned long long> underruns;
+
+    void DecodeLoop() {
+        std::unique_ptr<MusicDecoder> track = OpenMusicDecoder(path);
+        if (!track) {
+            finished = true;
+            return;
+        }
+        SDL_AudioStream* convert = SDL_NewAudioStream(track->format, track->channels, track->rate, AUDIO_F32SYS, 2, deviceRate);
+        if (!convert) {
+            LOG_ERROR("Failed to stream music {}: {}", path, SDL_GetError());
+            finished = true;
+            return;
+        }
+
+        std::vector<Uint8> input(READ_BYTES - READ_BYTES % track->frameBytes);
+        std::vector<float> output(READ_BYTES);
+        bool playedSinceRewind = false;
+        bool flushed = false;
+        while (!stopping) {
+            // Never hold more converted audio than the ring can take.
+            if (SDL_AudioStreamAvailable(convert) > 0 || flushed) {
+                size_t space = ring.Free();
+                if (space == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                    continue;
+                }
+                size_t want = space < output.size() ? space : output.size();
+                int bytes = SDL_AudioStreamGet(convert, output.data(), static_cast<int>(want * sizeof(float)));
+                if (bytes > 0) {
+                    ring.Write(output.data(), bytes / sizeof(float));
+                    continue;
+                }
+                if (flushed) {
+                    break;
+                }
+            }
+            size_t got = track->Read(input.data(), input.size());
+            if (got == 0) {
+                if (loop && playedSinceRewind && track->Rewind()) {
+                    playedSinceRewind = false;
+                } else {
+                    SDL_AudioStreamFlush(convert);
+                    flushed = true;
+                }
+                continue;
+            }
+            playedSinceRewind = true;
+            SDL_AudioStreamPut(convert, input.data(), static_cast<int>(got));
+        }
+        SDL_FreeAudioStream(convert);
+        finished = true;
+    }
+};
+
+#endif
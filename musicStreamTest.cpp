@@ -0,0 +1,132 @@
+#define SDL_MAIN_HANDLED
+#include "musicStream.h"
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// End-to-end check for musicStream.h without an audio device. The track is
+// streamed through MusicStream's decoder thread and ring while this thread
+// plays the audio callback, pulling one device block at a time at a
+// multiple of real time. What comes out must match the whole file decoded
+// up front and converted on this thread, sample for sample, with no underruns
+// after the first block. A second pass at the file's own rate checks that a
+// looping track wraps back to its first sample. Exits non-zero on failure.
+
+static const int BLOCK_FRAMES = 1024;
+
+// Whole-file reference: the same decoder run to the end on this thread,
+// converted to stereo float in the same 4 KiB pieces the decoder thread
+// reads. SDL's resampler does not give bit-identical output for one big put
+// and many small ones, and the point here is the thread and ring, not the
+// resampler or the decoder. Returns the file's own rate, 0 on failure.
+static const size_t PIECE_BYTES = 4096;
+
+static int DecodeAll(const char* path, int rate, vector<float>& out) {
+    unique_ptr<MusicDecoder> track = OpenMusicDecoder(path);
+    if (!track) {
+        return 0;
+    }
+    if (rate == 0) {
+        rate = track->rate;
+    }
+    SDL_AudioStream* convert = SDL_NewAudioStream(track->format, track->channels, track->rate, AUDIO_F32SYS, 2, rate);
+    vector<Uint8> piece(PIECE_BYTES - PIECE_BYTES % track->frameBytes);
+    vector<float> block(PIECE_BYTES);
+    out.clear();
+    for (;;) {
+        size_t bytes = track->Read(piece.data(), piece.size());
+        if (bytes == 0) {
+            SDL_AudioStreamFlush(convert);
+        } else {
+            SDL_AudioStreamPut(convert, piece.data(), static_cast<int>(bytes));
+        }
+        int got;
+        while ((got = SDL_AudioStreamGet(convert, block.data(), static_cast<int>(block.size() * sizeof(float)))) > 0) {
+            out.insert(out.end(), block.begin(), block.begin() + got / sizeof(float));
+        }
+        if (bytes == 0) {
+            break;
+        }
+    }
+    SDL_FreeAudioStream(convert);
+    return track->rate;
+}
+
+// Plays the callback: reads `frames` frames, one block every block length
+// divided by speed.
+static vector<float> Pull(MusicStream& stream, int rate, size_t frames, double speed) {
+    vector<float> out;
+    vector<float> block(BLOCK_FRAMES * 2);
+    const auto period = chrono::duration<double>(BLOCK_FRAMES / (rate * speed));
+    auto next = chrono::steady_clock::now();
+    while (out.size() < frames * 2) {
+        int got = stream.Read(block.data(), BLOCK_FRAMES);
+        out.insert(out.end(), block.begin(), block.begin() + got * 2);
+        if (got < BLOCK_FRAMES && stream.Underruns() == 0) {
+            break;  // finished
+        }
+        next += chrono::duration_cast<chrono::steady_clock::duration>(period);
+        this_thread::sleep_until(next);
+    }
+    return out;
+}
+
+static double MaxDifference(const vector<float>& a, const vector<float>& b, size_t count) {
+    double worst = 0;
+    for (size_t i = 0; i < count; ++i) {
+        worst = max(worst, static_cast<double>(fabs(a[i] - b[i])));
+    }
+    return worst;
+}
+
+int main(int argc, char** argv) {
+    const char* path = argc > 1 ? argv[1] : "bgmusic.mp3";
+    int rate = argc > 2 ? atoi(argv[2]) : 48000;
+    double speed = argc > 3 ? atof(argv[3]) : 8.0;
+    bool ok = true;
+
+    vector<float> reference;
+    if (!DecodeAll(path, rate, reference)) {
+        return 1;
+    }
+    vector<float> native;
+    const int fileRate = DecodeAll(path, 0, native);
+    MusicStream stream;
+    stream.Open(path, rate, false);
+    // The game starts music before the first frame too.
+    this_thread::sleep_for(chrono::milliseconds(50));
+    auto start = chrono::steady_clock::now();
+    vector<float> streamed = Pull(stream, rate, reference.size() / 2 + BLOCK_FRAMES, speed);
+    double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stream.Close();
+    double diff = MaxDifference(streamed, reference, min(streamed.size(), reference.size()));
+    cout << path << " at " << rate << " Hz: streamed " << streamed.size() / 2 << " of " << reference.size() / 2 << " frames in " << elapsed
+         << " s (" << speed << "x real time), " << stream.Underruns() << " underruns, max difference " << diff << endl;
+    cout << "ring holds " << MusicStream::RING_MS << " ms (" << rate * MusicStream::RING_MS / 1000 * 2 * sizeof(float) / 1024
+         << " KiB), whole track " << reference.size() * sizeof(float) / 1024 << " KiB" << endl;
+    ok = ok && streamed.size() == reference.size() && diff < 1e-6 && stream.Underruns() == 0;
+
+    // Looping at the file's own rate only converts the sample format, so the
+    // second pass must repeat the first exactly.
+    stream.Open(path, fileRate, true);
+    this_thread::sleep_for(chrono::milliseconds(50));
+    size_t frames = native.size() / 2;
+    vector<float> looped = Pull(stream, fileRate, frames + frames / 4, speed * 2);
+    stream.Close();
+    bool wrapped = looped.size() >= (frames + frames / 4) * 2;
+    for (size_t i = 0; wrapped && i < frames / 4 * 2; ++i) {
+        wrapped = looped[frames * 2 + i] == native[i];
+    }
+    cout << "loop at " << fileRate << " Hz: " << (wrapped ? "wraps to the first sample" : "does not wrap cleanly") << ", " << stream.Underruns()
+         << " underruns" << endl;
+    ok = ok && wrapped && stream.Underruns() == 0;
+
+    cout << (ok ? "PASS" : "FAIL") << endl;
+    return ok ? 0 : 1;
+}
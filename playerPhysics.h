@@ -0,0 +1,147 @@
+#ifndef PLAYER_PHYSICS_H
+#define PLAYER_PHYSICS_H
+
+#include "collisionMask.h"
+#include "fixedPoint.h"
+
+// One simulation tick of player movement, without SDL, so it can run
+// headless (fixedPointTest replays a fixed input script against golden
+// positions). It only reads the collision mask and only does Fixed maths,
+// so the same inputs give the same trajectory on every build.
+
+// A tick is split into enough substeps that nothing moves further than
+// maxStep between two collision checks, up to maxSubsteps.
+struct SubstepConfig {
+    Fixed maxStep;
+    int maxSubsteps;
+};
+
+struct SubstepStats {
+    unsigned long long ticks;
+    unsigned long long substeppedTicks;
+    unsigned long long substeps;
+};
+
+struct PlayerTuning {
+    Fixed speed, jumpVelocity, gravity;
+    int tileSize;
+};
+
+struct PlayerBody {
+    Fixed x, y, velocityY;
+    bool jumping;
+};
+
+struct PlayerInput {
+    bool left, right, jump;
+};
+
+// What happened during a tick, and where, for the caller's events.
+struct PlayerStep {
+    bool landed, jumped;
+    Fixed landX, landY, jumpX, jumpY;
+};
+
+inline int PlayerTileOf(Fixed v, int tileSize) { return FloorDiv(v.FloorToInt(), tileSize); }
+
+inline int SubstepCount(Fixed fastest, const SubstepConfig& config) {
+    int count = (fastest.raw + config.maxStep.raw - 1) / config.maxStep.raw;
+    if (count < 1) {
+        return 1;
+    }
+    return count < config.maxSubsteps ? count : config.maxSubsteps;
+}
+
+// 1 if the tile (dx, dy) away from the player's tile is solid, 0 if not,
+// -1 off the map.
+inline int ProbeSolid(const PlayerBody& body, int tileSize, const CollisionMask& solids, int dx, int dy) {
+    int x = PlayerTileOf(body.x, tileSize) + dx, y = PlayerTileOf(body.y, tileSize) + dy;
+    if (solids.Contains(x, y)) {
+        return solids.Solid(x, y) ? 1 : 0;
+    }
+    return -1;
+}
+
+inline PlayerStep StepPlayer(PlayerBody& body, const PlayerInput& input, const PlayerTuning& tuning,
+                             const SubstepConfig& substeps, const CollisionMask& solids, SubstepStats& stats) {
+    PlayerStep result = {};
+    const int tile = tuning.tileSize;
+    if (body.jumping) body.velocityY += tuning.gravity;
+
+    const Fixed tickVelocityY = body.velocityY;
+    const Fixed speedX = (input.left || input.right) ? tuning.speed : Fixed();
+    const Fixed fastest = speedX > Abs(tickVelocityY) ? speedX : Abs(tickVelocityY);
+    const int steps = SubstepCount(fastest, substeps);
+    stats.ticks++;
+    stats.substeps += steps;
+    if (steps > 1) {
+        stats.substeppedTicks++;
+    }
+
+    // The last substep takes the rounding remainder so a tick always covers
+    // exactly speed and velocityY, whatever the substep count.
+    bool movingY = true;
+    for (int i = 0; i < steps; ++i) {
+        const bool last = i == steps - 1;
+        const Fixed stepX = last ? tuning.speed - (tuning.speed / steps) * (steps - 1) : tuning.speed / steps;
+        const Fixed stepY = last ? tickVelocityY - (tickVelocityY / steps) * (steps - 1) : tickVelocityY / steps;
+
+        if (input.left) {
+            if (PlayerTileOf(body.x, tile) > 0) {
+                body.x -= stepX;
+                if (ProbeSolid(body, tile, solids, 0, 0) == 1) {
+                    body.x = Fixed::FromInt((PlayerTileOf(body.x, tile) + 1) * tile);
+                }
+            }
+        }
+        if (input.right) {
+            if (PlayerTileOf(body.x, tile) != solids.Width() - 1) {
+                body.x += stepX;
+                if (ProbeSolid(body, tile, solids, 1, 0) == 1) {
+                    body.x = Fixed::FromInt(PlayerTileOf(body.x, tile) * tile);
+                }
+            }
+        }
+
+        if (!movingY) {
+            continue;
+        }
+        body.y += stepY;
+        if (body.velocityY > Fixed() && (ProbeSolid(body, tile, solids, 0, 1) == 1 || ProbeSolid(body, tile, solids, 1, 1) == 1)) {
+            body.y = Fixed::FromInt(PlayerTileOf(body.y, tile) * tile);
+            body.velocityY = Fixed();
+            // Standing still re-lands every tick after one tick of gravity;
+            // only a real fall counts as landing.
+            if (body.jumping && tickVelocityY > tuning.gravity) {
+                result.landed = true;
+                result.landX = body.x;
+                result.landY = body.y;
+            }
+            body.jumping = false;
+            movingY = false;
+        } else if (body.velocityY < Fixed() && ProbeSolid(body, tile, solids, 0, 0) == 1) {
+            body.y = Fixed::FromInt((PlayerTileOf(body.y, tile) + 1) * tile);
+            body.velocityY = Fixed();
+            movingY = false;
+        }
+    }
+
+    if (input.jump && !body.jumping) {
+        body.jumping = true;
+        body.velocityY -= tuning.jumpVelocity;
+        result.jumped = true;
+        result.jumpX = body.x;
+        result.jumpY = body.y;
+    }
+
+    if (body.velocityY <= Fixed() && ProbeSolid(body, tile, solids, 0, 0) == 1) {
+        body.y = Fixed::FromInt((PlayerTileOf(body.y, tile) + 1) * tile);
+        body.velocityY = Fixed();
+    }
+    if (body.velocityY == Fixed() && ProbeSolid(body, tile, solids, 0, 0) != 1) {
+        body.jumping = true;
+    }
+    return result;
+}
+
+#endif
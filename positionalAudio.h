@@ -0,0 +1,155 @@
+#ifndef POSITIONAL_AUDIO_H
+#define POSITIONAL_AUDIO_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "voiceMixer.h"
+
+// Sounds placed in the world. Play() only records a source; once per frame
+// Update() works out gain and pan for every active source in one pass over
+// flat arrays (distance from the listener, usually the camera centre), and
+// only then talks to the mixer (SoftMixer voices, or SDL_mixer channels
+// through SfxSystem): sources outside the culling radius never cost a mixer
+// command, and playing voices are only touched when their gain or pan
+// actually moved. One-shot sources are forgotten once started (or
+// culled); looping sources stay until Stop() and are started and stopped as
+// they enter and leave the radius.
+
+struct PositionalStats {
+    unsigned long long started;
+    unsigned long long culled;
+    unsigned long long updated;
+};
+
+class PositionalAudio {
+public:
+    // Sources fade out linearly up to cullRadius pixels away and are panned
+    // fully to one side at panWidth pixels off-centre.
+    PositionalAudio(VoiceMixer& m, float cullRadius, float panWidth)
+        : mixer(&m), radius(cullRadius), invPanWidth(1.0f / panWidth), stats() {}
+
+    // Before the first Play(); voice ids do not carry over between mixers.
+    void SetMixer(VoiceMixer& m) { mixer = &m; }
+
+    // Any sound id of the current mixer. Returns a source id for
+    // Move()/Stop().
+    int Play(int sound, float x, float y, float gain = 1.0f, bool loop = false) {
+        int id;
+        if (!freeSlots.empty()) {
+            id = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            id = static_cast<int>(xs.size());
+            xs.push_back(0);
+            ys.push_back(0);
+            gains.push_back(0);
+            sounds.push_back(-1);
+            voices.push_back(0);
+            flags.push_back(0);
+            outGain.push_back(0);
+            outPan.push_back(0);
+            lastGain.push_back(0);
+            lastPan.push_back(0);
+        }
+        xs[id] = x;
+        ys[id] = y;
+        gains[id] = gain;
+        sounds[id] = sound;
+        voices[id] = 0;
+        flags[id] = FLAG_ACTIVE | (loop ? FLAG_LOOP : 0);
+        return id;
+    }
+
+    void Move(int source, float x, float y) {
+        xs[source] = x;
+        ys[source] = y;
+    }
+
+    void Stop(int source) {
+        if (!(flags[source] & FLAG_ACTIVE)) {
+            return;
+        }
+        if (voices[source]) {
+            mixer->Stop(voices[source]);
+        }
+        Release(source);
+    }
+
+    // Once per frame on the thread that calls Play().
+    void Update(float listenerX, float listenerY) {
+        const int count = static_cast<int>(xs.size());
+        const float r2 = radius * radius;
+        const float invRadius = 1.0f / radius;
+
+        // Batched pass: plain arithmetic over the arrays, no mixer calls.
+        for (int i = 0; i < count; ++i) {
+            float dx = xs[i] - listenerX;
+            float dy = ys[i] - listenerY;
+            float d2 = dx * dx + dy * dy;
+            float attenuation = d2 < r2 ? 1.0f - std::sqrt(d2) * invRadius : 0.0f;
+            float pan = dx * invPanWidth;
+            outGain[i] = (flags[i] & FLAG_ACTIVE) ? gains[i] * attenuation : 0.0f;
+            outPan[i] = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+        }
+
+        for (int i = 0; i < count; ++i) {
+            if (!(flags[i] & FLAG_ACTIVE)) {
+                continue;
+            }
+            bool loop = (flags[i] & FLAG_LOOP) != 0;
+            if (outGain[i] <= 0.0f) {
+                stats.culled++;
+                if (voices[i]) {
+                    mixer->Stop(voices[i]);
+                    voices[i] = 0;
+                }
+                if (!loop) {
+                    Release(i);
+                }
+                continue;
+            }
+            if (!voices[i]) {
+                voices[i] = mixer->Play(sounds[i], outGain[i], outPan[i], loop);
+                stats.started++;
+                if (!loop) {
+                    Release(i);
+                    continue;
+                }
+            } else if (std::fabs(outGain[i] - lastGain[i]) > EPSILON || std::fabs(outPan[i] - lastPan[i]) > EPSILON) {
+                mixer->SetVoice(voices[i], outGain[i], outPan[i]);
+                stats.updated++;
+            } else {
+                continue;
+            }
+            lastGain[i] = outGain[i];
+            lastPan[i] = outPan[i];
+        }
+    }
+
+    const PositionalStats& Stats() const { return stats; }
+
+private:
+    enum { FLAG_ACTIVE = 1, FLAG_LOOP = 2 };
+    static constexpr float EPSILON = 1.0f / 256.0f;
+
+    VoiceMixer* mixer;
+    float radius;
+    float invPanWidth;
+    // One entry per source slot, structure-of-arrays so the per-frame pass
+    // streams through memory.
+    std::vector<float> xs, ys, gains;
+    std::vector<int> sounds, voices;
+    std::vector<uint8_t> flags;
+    std::vector<float> outGain, outPan, lastGain, lastPan;
+    std::vector<int> freeSlots;
+    PositionalStats stats;
+
+    void Release(int source) {
+        flags[source] = 0;
+        voices[source] = 0;
+        freeSlots.push_back(source);
+    }
+};
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef SCENE_MANAGER_H
+#define SCENE_MANAGER_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// How a scene wants its frames paced. Static screens (menus, pause, win)
+// are idle: they draw once and then sleep inside SDL_WaitEventTimeout until
+// input arrives or idleTimeoutMs passes. Every scene is capped at maxFps
+// (0 means uncapped), idle ones included, so a stream of mouse motion
+// cannot make a menu redraw faster than that.
+struct FramePolicy {
+    bool idle;
+    int maxFps;
+    int idleTimeoutMs;
+};
+
+// Tracks the current scene of a game loop and paces frames for it:
+//
+//     while (running) {
+//         scenes.WaitForNextFrame();
+//         handleInput();
+//         if (scenes.NeedsRender()) { draw(); scenes.FrameRendered(); }
+//     }
+class SceneManager {
+public:
+    SceneManager() : current(0), dirty(true), lastFrame(0) {}
+
+    void SetPolicy(int scene, const FramePolicy& policy) {
+        if (scene >= static_cast<int>(policies.size())) {
+            policies.resize(scene + 1, FramePolicy{false, 0, 0});
+        }
+        policies[scene] = policy;
+    }
+
+    // Switching scenes always redraws once.
+    void SetScene(int scene) {
+        if (scene != current) {
+            current = scene;
+            dirty = true;
+        }
+    }
+    int Scene() const { return current; }
+
+    void Invalidate() { dirty = true; }
+    bool NeedsRender() const { return dirty || !Policy().idle; }
+
+    void FrameRendered() {
+        dirty = false;
+        lastFrame = SDL_GetTicks64();
+    }
+
+    // Blocks until the current scene's next frame is due. Idle scenes wait
+    // for input without taking it off the queue, so the regular event
+    // handling still sees it.
+    void WaitForNextFrame() {
+        const FramePolicy& policy = Policy();
+        if (policy.idle) {
+            if (!dirty && SDL_WaitEventTimeout(nullptr, policy.idleTimeoutMs) == 1) {
+                dirty = true;
+            }
+        }
+        if (policy.maxFps > 0) {
+            Uint64 frameMs = 1000 / policy.maxFps;
+            Uint64 elapsed = SDL_GetTicks64() - lastFrame;
+            if (elapsed < frameMs) {
+                SDL_Delay(static_cast<Uint32>(frameMs - elapsed));
+            }
+        }
+    }
+
+private:
+    std::vector<FramePolicy> policies;
+    int current;
+    bool dirty;
+    Uint64 lastFrame;
+
+    const FramePolicy& Policy() const {
+        static const FramePolicy uncapped = {false, 0, 0};
+        return current < static_cast<int>(policies.size()) ? policies[current] : uncapped;
+    }
+};
+
+#endif
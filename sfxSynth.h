@@ -0,0 +1,110 @@
+#ifndef SFX_SYNTH_H
+#define SFX_SYNTH_H
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Procedural stand-ins for the game's sound effects, so jump/land/death/win
+// play even without their .wav files. Each effect is a few tone segments
+// (frequency sweep, waveform, volume) rendered to a 16-bit mono PCM WAV in
+// memory, which SfxSystem::Load() hands to SDL_mixer like a file; SDL_mixer
+// converts it to the device format. Output is deterministic.
+
+enum SynthWave {
+    SYNTH_SQUARE,
+    SYNTH_TRIANGLE,
+    SYNTH_NOISE
+};
+
+struct SynthTone {
+    float startHz, endHz;
+    float seconds;
+    SynthWave wave;
+    float volume;
+};
+
+const int SYNTH_SAMPLE_RATE = 22050;
+
+inline void PutWavLittle(std::vector<uint8_t>& out, uint32_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+// Segments play back to back. Each one fades in over a few milliseconds and
+// decays linearly to silence, so segments join without clicks.
+inline std::vector<uint8_t> SynthEffect(const std::vector<SynthTone>& tones) {
+    std::vector<int16_t> samples;
+    uint32_t noise = 0x12345678u;
+    const float attack = 0.004f * SYNTH_SAMPLE_RATE;
+    for (const SynthTone& tone : tones) {
+        const int count = static_cast<int>(tone.seconds * SYNTH_SAMPLE_RATE);
+        double phase = 0;
+        float held = 0;
+        for (int i = 0; i < count; ++i) {
+            const float t = static_cast<float>(i) / count;
+            const float hz = tone.startHz + (tone.endHz - tone.startHz) * t;
+            const double before = phase;
+            phase += hz / SYNTH_SAMPLE_RATE;
+            phase -= std::floor(phase);
+            float value;
+            switch (tone.wave) {
+                case SYNTH_SQUARE:
+                    value = phase < 0.5 ? 1.0f : -1.0f;
+                    break;
+                case SYNTH_TRIANGLE:
+                    value = static_cast<float>(phase < 0.5 ? 4 * phase - 1 : 3 - 4 * phase);
+                    break;
+                default:
+                    // Sample-and-hold noise, a new value every cycle of hz.
+                    if (phase < before || i == 0) {
+                        noise = noise * 1664525u + 1013904223u;
+                        held = static_cast<float>(noise >> 16) / 32768.0f - 1.0f;
+                    }
+                    value = held;
+                    break;
+            }
+            const float envelope = (i < attack ? i / attack : 1.0f) * (1.0f - t);
+            samples.push_back(static_cast<int16_t>(value * envelope * tone.volume * 32767));
+        }
+    }
+
+    const uint32_t dataBytes = static_cast<uint32_t>(samples.size() * 2);
+    std::vector<uint8_t> wav;
+    wav.reserve(44 + dataBytes);
+    wav.insert(wav.end(), {'R', 'I', 'F', 'F'});
+    PutWavLittle(wav, 36 + dataBytes, 4);
+    wav.insert(wav.end(), {'W', 'A', 'V', 'E', 'f', 'm', 't', ' '});
+    PutWavLittle(wav, 16, 4);
+    PutWavLittle(wav, 1, 2);  // PCM
+    PutWavLittle(wav, 1, 2);  // mono
+    PutWavLittle(wav, SYNTH_SAMPLE_RATE, 4);
+    PutWavLittle(wav, SYNTH_SAMPLE_RATE * 2, 4);
+    PutWavLittle(wav, 2, 2);
+    PutWavLittle(wav, 16, 2);
+    wav.insert(wav.end(), {'d', 'a', 't', 'a'});
+    PutWavLittle(wav, dataBytes, 4);
+    for (int16_t s : samples) {
+        PutWavLittle(wav, static_cast<uint16_t>(s), 2);
+    }
+    return wav;
+}
+
+inline std::vector<uint8_t> SynthJump() {
+    return SynthEffect({{280, 760, 0.14f, SYNTH_SQUARE, 0.35f}});
+}
+inline std::vector<uint8_t> SynthLand() {
+    return SynthEffect({{900, 300, 0.08f, SYNTH_NOISE, 0.5f}});
+}
+inline std::vector<uint8_t> SynthDeath() {
+    return SynthEffect({{520, 90, 0.6f, SYNTH_SQUARE, 0.35f}, {200, 60, 0.25f, SYNTH_NOISE, 0.4f}});
+}
+inline std::vector<uint8_t> SynthWin() {
+    return SynthEffect({{523, 523, 0.12f, SYNTH_TRIANGLE, 0.6f},
+                        {659, 659, 0.12f, SYNTH_TRIANGLE, 0.6f},
+                        {784, 784, 0.12f, SYNTH_TRIANGLE, 0.6f},
+                        {1047, 1047, 0.45f, SYNTH_TRIANGLE, 0.6f}});
+}
+
+#endif
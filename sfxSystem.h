@@ -0,0 +1,255 @@
+#ifndef SFX_SYSTEM_H
+#define SFX_SYSTEM_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+#include <vector>
+#include "logger.h"
+#include "mpscRing.h"
+#include "voiceMixer.h"
+
+// Sound effects on a fixed pool of SDL_mixer channels. Chunks are loaded
+// once up front. Trigger() only pushes a small request into a lock-free
+// ring, so any thread can fire sounds without allocating or locking; the
+// owning thread calls Update() once per frame to rate-limit the requests
+// and start them, stealing the least important voice when every channel is
+// busy. As a VoiceMixer it also plays voices with a gain and pan (set with
+// Mix_Volume and Mix_SetPanning) that can be changed or stopped later, so
+// PositionalAudio can place effects without the soft mixer.
+
+struct SfxStats {
+    unsigned long long played;
+    unsigned long long stolen;
+    unsigned long long limited;
+    unsigned long long dropped;
+};
+
+class SfxSystem : public VoiceMixer {
+public:
+    SfxSystem() : stats(), overflowed(0), nextVoiceId(1) {}
+    ~SfxSystem() { Shutdown(); }
+
+    // Call after Mix_OpenAudio().
+    void Open(int channelCount) {
+        Mix_AllocateChannels(channelCount);
+        voices.assign(channelCount, Voice{-1, 0, 0, 0});
+    }
+
+    // Setup only. minIntervalMs throttles repeats of the same sound and
+    // maxInstances caps how many copies may play at once. Returns the id to
+    // pass to Trigger(), or -1 if the file could not be loaded.
+    int Load(const char* path, int priority, Uint32 minIntervalMs, int maxInstances) {
+        return Add(Mix_LoadWAV(path), path, priority, minIntervalMs, maxInstances);
+    }
+
+    // Same, but uses the in-memory WAV (see sfxSynth.h) when there is no
+    // file at path, so effects work without their assets.
+    int Load(const char* path, const std::vector<Uint8>& fallback, int priority, Uint32 minIntervalMs, int maxInstances) {
+        SDL_RWops* file = SDL_RWFromFile(path, "rb");
+        if (file) {
+            return Add(Mix_LoadWAV_RW(file, 1), path, priority, minIntervalMs, maxInstances);
+        }
+        SDL_RWops* memory = SDL_RWFromConstMem(fallback.data(), static_cast<int>(fallback.size()));
+        return Add(Mix_LoadWAV_RW(memory, 1), path, priority, minIntervalMs, maxInstances);
+    }
+
+    // Any thread. volume is 0..MIX_MAX_VOLUME.
+    bool Trigger(int sound, int volume = MIX_MAX_VOLUME) {
+        if (sound < 0) {
+            return false;
+        }
+        return Push(Request{REQUEST_PLAY, sound, 0, volume, MAX_PAN, MAX_PAN, false});
+    }
+
+    // Any thread. Same limits as Trigger(); gain maps to the channel volume
+    // and pan turns the far side down, so a centred voice plays like
+    // Trigger() would.
+    int Play(int sound, float gain, float pan, bool loop = false) override {
+        if (sound < 0) {
+            return 0;
+        }
+        int id = nextVoiceId.fetch_add(1, std::memory_order_relaxed);
+        Uint8 left, right;
+        Balance(pan, left, right);
+        return Push(Request{REQUEST_PLAY, sound, id, VolumeOf(gain), left, right, loop}) ? id : 0;
+    }
+    bool SetVoice(int id, float gain, float pan) override {
+        Uint8 left, right;
+        Balance(pan, left, right);
+        return Push(Request{REQUEST_SET, -1, id, VolumeOf(gain), left, right, false});
+    }
+    bool Stop(int id) override {
+        return Push(Request{REQUEST_STOP, -1, id, 0, 0, 0, false});
+    }
+
+    // Owning thread, once per frame.
+    void Update() {
+        Uint32 now = SDL_GetTicks();
+        Request r;
+        while (requests.TryPop(r)) {
+            if (r.type != REQUEST_PLAY) {
+                int channel = ChannelOf(r.voice);
+                if (channel >= 0 && r.type == REQUEST_SET) {
+                    Mix_Volume(channel, r.volume);
+                    Mix_SetPanning(channel, r.left, r.right);
+                } else if (channel >= 0) {
+                    Mix_HaltChannel(channel);
+                }
+                continue;
+            }
+            if (r.sound >= static_cast<int>(sounds.size())) {
+                continue;
+            }
+            Sound& s = sounds[r.sound];
+            if ((s.everPlayed && now - s.lastPlayed < s.minIntervalMs) || Instances(r.sound) >= s.maxInstances) {
+                stats.limited++;
+                continue;
+            }
+            int channel = PickChannel(s.priority);
+            if (channel < 0) {
+                stats.dropped++;
+                continue;
+            }
+            // Panning is a per-channel effect that outlives the sound, so
+            // every start sets it (255/255 removes it).
+            Mix_Volume(channel, r.volume);
+            Mix_SetPanning(channel, r.left, r.right);
+            if (Mix_PlayChannel(channel, s.chunk, r.loop ? -1 : 0) < 0) {
+                continue;
+            }
+            voices[channel] = Voice{r.sound, s.priority, now, r.voice};
+            s.lastPlayed = now;
+            s.everPlayed = true;
+            stats.played++;
+        }
+    }
+
+    const Mix_Chunk* Chunk(int sound) const {
+        return sound >= 0 && sound < static_cast<int>(sounds.size()) ? sounds[sound].chunk : nullptr;
+    }
+
+    SfxStats Stats() const {
+        SfxStats s = stats;
+        s.dropped += overflowed.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    // Call before Mix_CloseAudio().
+    void Shutdown() {
+        if (!voices.empty()) {
+            Mix_HaltChannel(-1);
+        }
+        for (Sound& s : sounds) {
+            Mix_FreeChunk(s.chunk);
+        }
+        sounds.clear();
+        voices.clear();
+    }
+
+private:
+    struct Sound {
+        Mix_Chunk* chunk;
+        int priority;
+        Uint32 minIntervalMs;
+        int maxInstances;
+        Uint32 lastPlayed;
+        bool everPlayed;
+    };
+    struct Voice {
+        int sound;
+        int priority;
+        Uint32 started;
+        int id;
+    };
+    enum RequestType { REQUEST_PLAY, REQUEST_SET, REQUEST_STOP };
+    struct Request {
+        RequestType type;
+        int sound;
+        int voice;
+        int volume;
+        Uint8 left, right;
+        bool loop;
+    };
+    static const Uint8 MAX_PAN = 255;
+
+    std::vector<Sound> sounds;
+    std::vector<Voice> voices;
+    MpscRing<Request, 256> requests;
+    SfxStats stats;
+    std::atomic<unsigned long long> overflowed;
+    std::atomic<int> nextVoiceId;
+
+    bool Push(const Request& r) {
+        if (!requests.TryPush(r)) {
+            overflowed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    static int VolumeOf(float gain) {
+        gain = gain < 0.0f ? 0.0f : (gain > 1.0f ? 1.0f : gain);
+        return static_cast<int>(gain * MIX_MAX_VOLUME + 0.5f);
+    }
+
+    static void Balance(float pan, Uint8& left, Uint8& right) {
+        pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+        left = static_cast<Uint8>(MAX_PAN * (pan > 0.0f ? 1.0f - pan : 1.0f) + 0.5f);
+        right = static_cast<Uint8>(MAX_PAN * (pan < 0.0f ? 1.0f + pan : 1.0f) + 0.5f);
+    }
+
+    // The channel still playing voice id, or -1 if it finished or was
+    // stolen.
+    int ChannelOf(int id) const {
+        for (size_t c = 0; id != 0 && c < voices.size(); ++c) {
+            if (voices[c].id == id && Mix_Playing(static_cast<int>(c))) {
+                return static_cast<int>(c);
+            }
+        }
+        return -1;
+    }
+
+    int Add(Mix_Chunk* chunk, const char* path, int priority, Uint32 minIntervalMs, int maxInstances) {
+        if (!chunk) {
+            LOG_ERROR("Failed to load sound {}: {}", path, Mix_GetError());
+            return -1;
+        }
+        sounds.push_back({chunk, priority, minIntervalMs, maxInstances, 0, false});
+        return static_cast<int>(sounds.size()) - 1;
+    }
+
+    int Instances(int sound) const {
+        int count = 0;
+        for (size_t c = 0; c < voices.size(); ++c) {
+            if (voices[c].sound == sound && Mix_Playing(static_cast<int>(c))) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    // A free channel if there is one, otherwise the oldest of the lowest
+    // priority voices, provided it does not outrank the new sound.
+    int PickChannel(int priority) {
+        int victim = -1;
+        for (size_t c = 0; c < voices.size(); ++c) {
+            if (!Mix_Playing(static_cast<int>(c))) {
+                return static_cast<int>(c);
+            }
+            const Voice& v = voices[c];
+            if (victim < 0 || v.priority < voices[victim].priority ||
+                (v.priority == voices[victim].priority && v.started < voices[victim].started)) {
+                victim = static_cast<int>(c);
+            }
+        }
+        if (victim < 0 || voices[victim].priority > priority) {
+            return -1;
+        }
+        Mix_HaltChannel(victim);
+        stats.stolen++;
+        return victim;
+    }
+};
+
+#endif
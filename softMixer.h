@@ -0,0 +1,370 @@
+#ifndef SOFT_MIXER_H
+#define SOFT_MIXER_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "logger.h"
+#include "mpscRing.h"
+#include "voiceMixer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFT_MIXER_SSE2 1
+#endif
+
+// Optional software mixing backend. Voices are mono float samples with a
+// per-voice gain and pan, summed into an interleaved stereo float buffer
+// four frames at a time with SSE2 (scalar fallback elsewhere), and only
+// converted to the device format once at the end. Attach() hooks the mixer
+// into SDL_mixer's post-mix callback so its output is added on top of the
+// regular channels and music. Streams (MixerStream) such as streamed music
+// are pulled into the same buffer. Mix() can also be driven directly, e.g.
+// by the offline benchmark.
+
+// Adds src * (gainL, gainR) into interleaved stereo out.
+inline void MixMonoToStereo(const float* src, float* out, int frames, float gainL, float gainR, bool simd) {
+    int i = 0;
+#ifdef SOFT_MIXER_SSE2
+    if (simd) {
+        const __m128 gl = _mm_set1_ps(gainL);
+        const __m128 gr = _mm_set1_ps(gainR);
+        for (; i + 4 <= frames; i += 4) {
+            __m128 s = _mm_loadu_ps(src + i);
+            __m128 l = _mm_mul_ps(s, gl);
+            __m128 r = _mm_mul_ps(s, gr);
+            // l0 r0 l1 r1 | l2 r2 l3 r3
+            __m128 lo = _mm_unpacklo_ps(l, r);
+            __m128 hi = _mm_unpackhi_ps(l, r);
+            float* o = out + 2 * i;
+            _mm_storeu_ps(o, _mm_add_ps(_mm_loadu_ps(o), lo));
+            _mm_storeu_ps(o + 4, _mm_add_ps(_mm_loadu_ps(o + 4), hi));
+        }
+    }
+#else
+    (void)simd;
+#endif
+    for (; i < frames; ++i) {
+        out[2 * i] += src[i] * gainL;
+        out[2 * i + 1] += src[i] * gainR;
+    }
+}
+
+// Saturating dst += src for a float mix in [-1, 1] and signed 16-bit output.
+inline void AddFloatToS16(const float* src, Sint16* dst, int samples, bool simd) {
+    int i = 0;
+#ifdef SOFT_MIXER_SSE2
+    if (simd) {
+        const __m128 scale = _mm_set1_ps(32767.0f);
+        for (; i + 8 <= samples; i += 8) {
+            __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+            __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+            __m128i packed = _mm_packs_epi32(a, b);
+            __m128i* d = reinterpret_cast<__m128i*>(dst + i);
+            _mm_storeu_si128(d, _mm_adds_epi16(_mm_loadu_si128(d), packed));
+        }
+    }
+#else
+    (void)simd;
+#endif
+    for (; i < samples; ++i) {
+        float v = src[i] * 32767.0f;
+        v = v > 32767.0f ? 32767.0f : (v < -32768.0f ? -32768.0f : v);
+        int sum = dst[i] + static_cast<int>(std::lrint(v));
+        dst[i] = static_cast<Sint16>(sum > 32767 ? 32767 : (sum < -32768 ? -32768 : sum));
+    }
+}
+
+// out += src * gain, for already interleaved samples.
+inline void AddScaled(const float* src, float* out, int samples, float gain, bool simd) {
+    int i = 0;
+#ifdef SOFT_MIXER_SSE2
+    if (simd) {
+        const __m128 g = _mm_set1_ps(gain);
+        for (; i + 4 <= samples; i += 4) {
+            _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+        }
+    }
+#else
+    (void)simd;
+#endif
+    for (; i < samples; ++i) {
+        out[i] += src[i] * gain;
+    }
+}
+
+inline void AddFloatToF32(const float* src, float* dst, int samples) {
+    for (int i = 0; i < samples; ++i) {
+        dst[i] += src[i];
+    }
+}
+
+// Mono float samples at the device rate.
+struct SoftSound {
+    std::vector<float> samples;
+
+    // Down-mixes a chunk SDL_mixer has already converted to the device
+    // format (signed 16-bit, any channel count).
+    static std::shared_ptr<SoftSound> FromChunk(const Mix_Chunk* chunk, int channels) {
+        std::shared_ptr<SoftSound> sound(new SoftSound());
+        const Sint16* pcm = reinterpret_cast<const Sint16*>(chunk->abuf);
+        size_t frames = chunk->alen / sizeof(Sint16) / channels;
+        sound->samples.resize(frames);
+        for (size_t f = 0; f < frames; ++f) {
+            int sum = 0;
+            for (int c = 0; c < channels; ++c) {
+                sum += pcm[f * channels + c];
+            }
+            sound->samples[f] = sum / (32768.0f * channels);
+        }
+        return sound;
+    }
+};
+
+// Audio that is produced elsewhere (e.g. MusicStream) and pulled by the
+// mixer. Read() runs on the audio thread, fills up to frames interleaved
+// stereo frames and returns how many it wrote.
+class MixerStream {
+public:
+    virtual ~MixerStream() {}
+    virtual int Read(float* out, int frames) = 0;
+};
+
+class SoftMixer : public VoiceMixer {
+public:
+    static const int MAX_VOICES = 512;
+    static const int MAX_STREAMS = 4;
+    static const int BLOCK_FRAMES = 1024;
+
+    SoftMixer() : simd(true), attached(false), deviceFormat(0), deviceChannels(0), deviceFrequency(0), nextVoiceId(1) {
+        mixBuffer.resize(BLOCK_FRAMES * 2);
+        streamBuffer.resize(BLOCK_FRAMES * 2);
+        streams.reserve(MAX_STREAMS);
+        voices.reserve(MAX_VOICES);
+    }
+    ~SoftMixer() { Detach(); }
+
+    // Call after Mix_OpenAudio(). Only stereo S16 and F32 devices are
+    // supported.
+    bool Open() {
+        int frequency = 0, channels = 0;
+        Uint16 format = 0;
+        if (!Mix_QuerySpec(&frequency, &format, &channels)) {
+            LOG_ERROR("Soft mixer: audio not open: {}", Mix_GetError());
+            return false;
+        }
+        if (channels != 2 || (format != AUDIO_S16SYS && format != AUDIO_F32SYS)) {
+            LOG_ERROR("Soft mixer: unsupported device format");
+            return false;
+        }
+        deviceFormat = format;
+        deviceChannels = channels;
+        deviceFrequency = frequency;
+        return true;
+    }
+
+    // Sounds must be registered before Attach(). Returns the id to pass to
+    // Play().
+    int AddSound(std::shared_ptr<SoftSound> sound) {
+        sounds.push_back(sound);
+        return static_cast<int>(sounds.size()) - 1;
+    }
+    // A chunk loaded by SDL_mixer after Open(); -1 if it cannot be used.
+    int AddChunk(const Mix_Chunk* chunk) {
+        if (!chunk || deviceFormat != AUDIO_S16SYS) {
+            return -1;
+        }
+        return AddSound(SoftSound::FromChunk(chunk, deviceChannels));
+    }
+
+    // Any thread. pan is -1 (left) .. 1 (right). Returns a voice id for
+    // SetVoice()/Stop(), or 0 if the command queue was full.
+    int Play(int sound, float gain, float pan, bool loop = false) override {
+        int id = nextVoiceId.fetch_add(1, std::memory_order_relaxed);
+        Command c = {CMD_PLAY, id, sound, gain, pan, loop, nullptr};
+        return commands.TryPush(c) ? id : 0;
+    }
+    bool SetVoice(int id, float gain, float pan) override {
+        Command c = {CMD_SET, id, -1, gain, pan, false, nullptr};
+        return commands.TryPush(c);
+    }
+    bool Stop(int id) override {
+        Command c = {CMD_STOP, id, -1, 0.0f, 0.0f, false, nullptr};
+        return commands.TryPush(c);
+    }
+
+    // Any thread. The stream is read every block from then on and must
+    // outlive the mixer's attachment.
+    bool AddStream(MixerStream* stream, float gain) {
+        Command c = {CMD_STREAM, 0, -1, gain, 0.0f, false, stream};
+        return commands.TryPush(c);
+    }
+
+    int Frequency() const { return deviceFrequency; }
+
+    void SetSimd(bool enabled) { simd = enabled; }
+
+    // Adds the mixer's output on top of SDL_mixer's through the post-mix
+    // hook. Detach() before Mix_CloseAudio().
+    bool Attach() {
+        if (deviceChannels == 0) {
+            return false;
+        }
+        Mix_SetPostMix(&SoftMixer::PostMix, this);
+        attached = true;
+        return true;
+    }
+
+    void Detach() {
+        if (attached) {
+            Mix_SetPostMix(nullptr, nullptr);
+            attached = false;
+        }
+    }
+
+    // Mixes frames of interleaved stereo into out (overwritten). Audio
+    // thread (or the benchmark) only.
+    void Mix(float* out, int frames) {
+        ApplyCommands();
+        memset(out, 0, sizeof(float) * 2 * frames);
+        for (int v = 0; v < static_cast<int>(voices.size()); ++v) {
+            Voice& voice = voices[v];
+            const std::vector<float>& samples = sounds[voice.sound]->samples;
+            const int length = static_cast<int>(samples.size());
+            int done = 0;
+            while (done < frames && voice.position < length) {
+                int n = frames - done;
+                if (n > length - voice.position) {
+                    n = length - voice.position;
+                }
+                MixMonoToStereo(samples.data() + voice.position, out + 2 * done, n, voice.gainL, voice.gainR, simd);
+                voice.position += n;
+                done += n;
+                if (voice.position >= length && voice.loop) {
+                    voice.position = 0;
+                }
+            }
+            if (voice.position >= length && !voice.loop) {
+                // Swap-remove; revisit the voice that moved into this slot.
+                voices[v] = voices.back();
+                voices.pop_back();
+                --v;
+            }
+        }
+        for (const StreamSlot& slot : streams) {
+            for (int done = 0; done < frames;) {
+                int want = frames - done < BLOCK_FRAMES ? frames - done : BLOCK_FRAMES;
+                int got = slot.stream->Read(streamBuffer.data(), want);
+                AddScaled(streamBuffer.data(), out + 2 * done, got * 2, slot.gain, simd);
+                if (got < want) {
+                    break;
+                }
+                done += got;
+            }
+        }
+    }
+
+    int ActiveVoices() const { return static_cast<int>(voices.size()); }
+
+private:
+    enum CommandType { CMD_PLAY, CMD_SET, CMD_STOP, CMD_STREAM };
+    struct Command {
+        CommandType type;
+        int id;
+        int sound;
+        float gain;
+        float pan;
+        bool loop;
+        MixerStream* stream;
+    };
+    struct Voice {
+        int id;
+        int sound;
+        int position;
+        float gainL, gainR;
+        bool loop;
+    };
+    struct StreamSlot {
+        MixerStream* stream;
+        float gain;
+    };
+
+    std::vector<std::shared_ptr<SoftSound>> sounds;
+    std::vector<Voice> voices;
+    std::vector<StreamSlot> streams;
+    std::vector<float> mixBuffer;
+    std::vector<float> streamBuffer;
+    MpscRing<Command, 1024> commands;
+    bool simd;
+    bool attached;
+    Uint16 deviceFormat;
+    int deviceChannels;
+    int deviceFrequency;
+    std::atomic<int> nextVoiceId;
+
+    // Constant-power pan law.
+    static void PanGains(float gain, float pan, float& left, float& right) {
+        pan = pan < -1.0f ? -1.0f : (pan > 1.0f ? 1.0f : pan);
+        float angle = (pan + 1.0f) * 0.25f * 3.14159265f;
+        left = gain * std::cos(angle);
+        right = gain * std::sin(angle);
+    }
+
+    Voice* FindVoice(int id) {
+        for (Voice& v : voices) {
+            if (v.id == id) {
+                return &v;
+            }
+        }
+        return nullptr;
+    }
+
+    void ApplyCommands() {
+        Command c;
+        while (commands.TryPop(c)) {
+            if (c.type == CMD_STREAM) {
+                if (c.stream && static_cast<int>(streams.size()) < MAX_STREAMS) {
+                    streams.push_back({c.stream, c.gain});
+                }
+            } else if (c.type == CMD_PLAY) {
+                if (c.sound < 0 || c.sound >= static_cast<int>(sounds.size()) || static_cast<int>(voices.size()) >= MAX_VOICES) {
+                    continue;
+                }
+                Voice v = {c.id, c.sound, 0, 0.0f, 0.0f, c.loop};
+                PanGains(c.gain, c.pan, v.gainL, v.gainR);
+                voices.push_back(v);
+            } else if (Voice* v = FindVoice(c.id)) {
+                if (c.type == CMD_SET) {
+                    PanGains(c.gain, c.pan, v->gainL, v->gainR);
+                } else {
+                    v->loop = false;
+                    v->position = static_cast<int>(sounds[v->sound]->samples.size());
+                }
+            }
+        }
+    }
+
+    static void SDLCALL PostMix(void* udata, Uint8* stream, int len) {
+        SoftMixer* self = static_cast<SoftMixer*>(udata);
+        const int bytesPerSample = self->deviceFormat == AUDIO_F32SYS ? 4 : 2;
+        int frames = len / (bytesPerSample * self->deviceChannels);
+        int offset = 0;
+        while (frames > 0) {
+            int n = frames < BLOCK_FRAMES ? frames : BLOCK_FRAMES;
+            self->Mix(self->mixBuffer.data(), n);
+            if (self->deviceFormat == AUDIO_F32SYS) {
+                AddFloatToF32(self->mixBuffer.data(), reinterpret_cast<float*>(stream) + offset, n * 2);
+            } else {
+                AddFloatToS16(self->mixBuffer.data(), reinterpret_cast<Sint16*>(stream) + offset, n * 2, self->simd);
+            }
+            offset += n * 2;
+            frames -= n;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,196 @@
+#ifndef TILE_ATLAS_H
+#define TILE_ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "autotile.h"
+#include "logger.h"
+
+// Tile artwork shared by the game and the level editor, so both show a
+// level the same way. Every tile type's image is scaled into one cell of a
+// single texture (consecutive copies from one texture batch well), and the
+// average colour of each cell is kept for minimaps and zoomed-out views.
+// Types without an image are a solid colour, or nothing at all for empty.
+// After the tile types come the AUTOTILE_VARIANTS ground variants, made
+// from the soil and grass images: grass where the top is exposed, soil
+// otherwise, with a dark border along every other exposed edge.
+
+const int TILE_TYPES = 6;
+const int TILE_EMPTY = 0;
+const int TILE_SPAWN = 5;
+
+struct TileArt {
+    const char* image;
+    SDL_Color color;
+    // The spawn marker only exists in the editor; the game draws the player
+    // there instead.
+    bool inGame;
+};
+
+const TileArt TILE_ART[TILE_TYPES] = {
+    {nullptr, {0, 0, 0, 0}, false},
+    {"soil.png", {0, 0, 0, 0}, true},
+    {"grass.png", {0, 0, 0, 0}, true},
+    {"flag.png", {0, 0, 0, 0}, true},
+    {nullptr, {0, 0, 160, 255}, true},
+    {"playerpic2.png", {0, 0, 0, 0}, false},
+};
+
+class TileAtlas {
+public:
+    static const int CELL = 32;
+    static const int EDGE_WIDTH = 3;
+
+    TileAtlas() : texture(nullptr), hasVariants(false) {
+        for (int type = 0; type < TILE_TYPES; ++type) {
+            average[type] = SDL_Color{0, 0, 0, 0};
+        }
+    }
+    ~TileAtlas() { Destroy(); }
+
+    static bool HasArt(int type) {
+        return type >= 0 && type < TILE_TYPES && (TILE_ART[type].image || TILE_ART[type].color.a > 0);
+    }
+    static bool InGame(int type) { return HasArt(type) && TILE_ART[type].inGame; }
+
+    // Decodes the images on the calling thread.
+    bool Load(SDL_Renderer* renderer) {
+        SDL_Surface* images[TILE_TYPES] = {};
+        for (int type = 0; type < TILE_TYPES; ++type) {
+            if (TILE_ART[type].image) {
+                images[type] = IMG_Load(TILE_ART[type].image);
+            }
+        }
+        bool ok = Build(renderer, images);
+        for (SDL_Surface* image : images) {
+            SDL_FreeSurface(image);
+        }
+        return ok;
+    }
+
+    // For callers that decode TILE_ART[type].image themselves (e.g. on the
+    // job system); images[type] may be null for types without one. The
+    // surfaces stay owned by the caller. A missing image leaves its cell
+    // empty rather than failing the whole atlas.
+    bool Build(SDL_Renderer* renderer, SDL_Surface* const images[TILE_TYPES]) {
+        Destroy();
+        SDL_Surface* sheet = SDL_CreateRGBSurfaceWithFormat(0, CELL * (TILE_TYPES + AUTOTILE_VARIANTS), CELL, 32, SDL_PIXELFORMAT_RGBA32);
+        if (!sheet) {
+            LOG_ERROR("Failed to create tile atlas: {}", SDL_GetError());
+            return false;
+        }
+        SDL_FillRect(sheet, nullptr, SDL_MapRGBA(sheet->format, 0, 0, 0, 0));
+        for (int type = 0; type < TILE_TYPES; ++type) {
+            SDL_Rect cell = Source(type);
+            const TileArt& art = TILE_ART[type];
+            if (art.image && images[type]) {
+                SDL_SetSurfaceBlendMode(images[type], SDL_BLENDMODE_NONE);
+                SDL_BlitScaled(images[type], nullptr, sheet, &cell);
+            } else if (art.image) {
+                LOG_ERROR("Failed to load {}: {}", art.image, IMG_GetError());
+            } else if (art.color.a > 0) {
+                SDL_FillRect(sheet, &cell, SDL_MapRGBA(sheet->format, art.color.r, art.color.g, art.color.b, art.color.a));
+            }
+            average[type] = Average(sheet, cell);
+        }
+        SDL_Surface* soil = images[1];
+        SDL_Surface* grass = images[2];
+        hasVariants = soil && grass;
+        for (int variant = 0; hasVariants && variant < AUTOTILE_VARIANTS; ++variant) {
+            SDL_Rect cell = VariantSource(variant);
+            SDL_BlitScaled((variant & AUTOTILE_NORTH) ? grass : soil, nullptr, sheet, &cell);
+            Uint32 edge = SDL_MapRGBA(sheet->format, 60, 40, 20, 255);
+            SDL_Rect east = {cell.x + CELL - EDGE_WIDTH, cell.y, EDGE_WIDTH, CELL};
+            SDL_Rect south = {cell.x, cell.y + CELL - EDGE_WIDTH, CELL, EDGE_WIDTH};
+            SDL_Rect west = {cell.x, cell.y, EDGE_WIDTH, CELL};
+            if (variant & AUTOTILE_EAST) {
+                SDL_FillRect(sheet, &east, edge);
+            }
+            if (variant & AUTOTILE_SOUTH) {
+                SDL_FillRect(sheet, &south, edge);
+            }
+            if (variant & AUTOTILE_WEST) {
+                SDL_FillRect(sheet, &west, edge);
+            }
+        }
+        texture = SDL_CreateTextureFromSurface(renderer, sheet);
+        SDL_FreeSurface(sheet);
+        if (!texture) {
+            LOG_ERROR("Failed to create tile atlas texture: {}", SDL_GetError());
+            return false;
+        }
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        return true;
+    }
+
+    // Call before the renderer is destroyed.
+    void Destroy() {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+    }
+
+    static SDL_Rect Source(int type) { return SDL_Rect{type * CELL, 0, CELL, CELL}; }
+    static SDL_Rect VariantSource(int variant) { return SDL_Rect{(TILE_TYPES + variant) * CELL, 0, CELL, CELL}; }
+
+    void Draw(SDL_Renderer* renderer, int type, const SDL_Rect& dst) const {
+        if (texture && HasArt(type)) {
+            SDL_Rect src = Source(type);
+            SDL_RenderCopy(renderer, texture, &src, &dst);
+        }
+    }
+
+    // variant comes from Autotiler::Variant(); AUTOTILE_NONE, or a missing
+    // soil or grass image, draws the plain tile.
+    void DrawTile(SDL_Renderer* renderer, int type, int variant, const SDL_Rect& dst) const {
+        if (variant == AUTOTILE_NONE || !hasVariants) {
+            Draw(renderer, type, dst);
+        } else {
+            DrawVariant(renderer, variant, dst);
+        }
+    }
+
+    void DrawVariant(SDL_Renderer* renderer, int variant, const SDL_Rect& dst) const {
+        if (texture && hasVariants) {
+            SDL_Rect src = VariantSource(variant);
+            SDL_RenderCopy(renderer, texture, &src, &dst);
+        }
+    }
+
+    // Alpha-weighted mean of the cell; alpha is the cell's coverage.
+    SDL_Color AverageColor(int type) const {
+        return type >= 0 && type < TILE_TYPES ? average[type] : SDL_Color{0, 0, 0, 0};
+    }
+
+    SDL_Texture* Texture() const { return texture; }
+    bool HasVariants() const { return hasVariants; }
+
+private:
+    SDL_Texture* texture;
+    SDL_Color average[TILE_TYPES];
+    bool hasVariants;
+
+    static SDL_Color Average(SDL_Surface* sheet, const SDL_Rect& cell) {
+        Uint64 r = 0, g = 0, b = 0, a = 0;
+        SDL_LockSurface(sheet);
+        for (int y = cell.y; y < cell.y + cell.h; ++y) {
+            const Uint8* p = static_cast<const Uint8*>(sheet->pixels) + y * sheet->pitch + cell.x * 4;
+            for (int x = 0; x < cell.w; ++x, p += 4) {
+                // RGBA32 is byte order R, G, B, A on every platform.
+                r += p[0] * p[3];
+                g += p[1] * p[3];
+                b += p[2] * p[3];
+                a += p[3];
+            }
+        }
+        SDL_UnlockSurface(sheet);
+        if (a == 0) {
+            return SDL_Color{0, 0, 0, 0};
+        }
+        return SDL_Color{static_cast<Uint8>(r / a), static_cast<Uint8>(g / a), static_cast<Uint8>(b / a),
+                         static_cast<Uint8>(a / (cell.w * cell.h))};
+    }
+};
+
+#endif
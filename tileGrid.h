@@ -0,0 +1,102 @@
+#ifndef TILE_GRID_H
+#define TILE_GRID_H
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+// Rectangular tile map whose rows are shared copy-on-write. Snapshot() is
+// O(rows): it only copies row pointers, and the next Set() on a row that a
+// snapshot still holds copies that one row first. That lets a background
+// thread read a frozen copy (e.g. while saving) while the owner keeps
+// editing. A single grid must only be used from one thread at a time.
+class TileGrid {
+public:
+    TileGrid() : width(0) {}
+    TileGrid(int w, int h, int fill = 0) : width(w) {
+        rows.reserve(h);
+        for (int y = 0; y < h; ++y) {
+            rows.push_back(std::make_shared<std::vector<int>>(w, fill));
+        }
+    }
+
+    // Takes ragged rows and pads them with 0 to the widest one.
+    static TileGrid FromRows(std::vector<std::vector<int>>&& source) {
+        TileGrid grid;
+        for (const std::vector<int>& row : source) {
+            grid.width = static_cast<int>(row.size()) > grid.width ? static_cast<int>(row.size()) : grid.width;
+        }
+        grid.rows.reserve(source.size());
+        for (std::vector<int>& row : source) {
+            row.resize(grid.width, 0);
+            grid.rows.push_back(std::make_shared<std::vector<int>>(std::move(row)));
+        }
+        return grid;
+    }
+
+    int Width() const { return width; }
+    int Height() const { return static_cast<int>(rows.size()); }
+    bool Contains(int x, int y) const { return x >= 0 && x < width && y >= 0 && y < Height(); }
+
+    int Get(int x, int y) const { return (*rows[y])[x]; }
+    const std::vector<int>& Row(int y) const { return *rows[y]; }
+
+    void Set(int x, int y, int value) {
+        std::shared_ptr<std::vector<int>>& row = rows[y];
+        if (row.use_count() > 1) {
+            row = std::make_shared<std::vector<int>>(*row);
+        }
+        (*row)[x] = value;
+    }
+
+    TileGrid Snapshot() const { return *this; }
+
+    // A deep copy that shares no rows, for handing a grid to another thread
+    // that will edit its copy independently.
+    TileGrid Clone() const {
+        TileGrid out;
+        out.width = width;
+        out.rows.reserve(rows.size());
+        for (const std::shared_ptr<std::vector<int>>& row : rows) {
+            out.rows.push_back(std::make_shared<std::vector<int>>(*row));
+        }
+        return out;
+    }
+
+    bool AllZero() const {
+        for (const std::shared_ptr<std::vector<int>>& row : rows) {
+            for (int value : *row) {
+                if (value != 0) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    // The w x h window whose top-left corner is (x, y); tiles that fall
+    // outside this grid are fill. Resizing is a crop at (0, 0).
+    TileGrid Cropped(int x, int y, int w, int h, int fill = 0) const {
+        TileGrid out(w, h, fill);
+        for (int row = 0; row < h; ++row) {
+            int sy = y + row;
+            if (sy < 0 || sy >= Height()) {
+                continue;
+            }
+            int first = x < 0 ? -x : 0;
+            int last = width - x < w ? width - x : w;
+            if (first < last) {
+                std::vector<int>& dst = *out.rows[row];
+                const std::vector<int>& src = *rows[sy];
+                std::copy(src.begin() + (x + first), src.begin() + (x + last), dst.begin() + first);
+            }
+        }
+        return out;
+    }
+
+private:
+    int width;
+    std::vector<std::shared_ptr<std::vector<int>>> rows;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Single-writer/single-reader triple buffer. The writer fills Back() and
+// publishes it; the reader picks up whatever was published last. Neither
+// side ever waits on the other: the only shared state is one atomic byte
+// holding the index of the middle slot plus a "fresh" bit.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() : middle(1), backIndex(0), frontIndex(2) {}
+
+    // Writer side.
+    T& Back() { return slots[backIndex]; }
+
+    // Hands the back slot to the reader. Returns false when the previously
+    // published slot was never consumed; Back() is then that same slot, still
+    // holding its contents, so the writer can carry unread deltas forward.
+    bool Publish() {
+        uint8_t prev = middle.exchange(static_cast<uint8_t>(backIndex | FRESH), std::memory_order_acq_rel);
+        backIndex = prev & INDEX_MASK;
+        return (prev & FRESH) == 0;
+    }
+
+    // Reader side. Returns true if a newer slot was picked up.
+    bool Consume() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        uint8_t prev = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = prev & INDEX_MASK;
+        return true;
+    }
+
+    const T& Front() const { return slots[frontIndex]; }
+
+private:
+    static const uint8_t INDEX_MASK = 0x3;
+    static const uint8_t FRESH = 0x4;
+
+    T slots[3];
+    std::atomic<uint8_t> middle;
+    uint8_t backIndex;
+    uint8_t frontIndex;
+};
+
+#endif
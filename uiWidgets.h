@@ -0,0 +1,341 @@
+#ifndef UI_WIDGETS_H
+#define UI_WIDGETS_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "logger.h"
+
+// Retained-mode menu widgets. A UiScreen owns a tree of widgets laid out
+// once at construction and a screen-sized render target that caches what
+// they look like. Render() only redraws widgets marked dirty into that cache
+// and then blits it, so an unchanged menu costs one texture copy per frame.
+
+class Widget {
+public:
+    explicit Widget(const SDL_Rect& r) : rect(r), parent(nullptr), dirty(true), visible(true) {}
+    virtual ~Widget() {}
+
+    template <typename T>
+    T* Add(T* child) {
+        child->parent = this;
+        children.push_back(std::unique_ptr<Widget>(child));
+        MarkDirty();
+        return child;
+    }
+
+    // Whatever shows through a widget that does not cover its whole rect
+    // belongs to the parent, so the parent repaints too.
+    void MarkDirty() {
+        dirty = true;
+        if (parent && !(visible && Opaque())) {
+            parent->MarkDirty();
+        }
+    }
+    void SetVisible(bool v) {
+        if (v != visible) {
+            visible = v;
+            // The parent has to repaint the area we leave behind.
+            if (parent) {
+                parent->MarkDirty();
+            }
+            dirty = true;
+        }
+    }
+    const SDL_Rect& Rect() const { return rect; }
+
+    // Draws into the current render target. A dirty widget repaints itself
+    // and everything inside it; a clean one only looks for dirty children.
+    // Only the outermost widget of a repaint clears its rect: MarkDirty()
+    // makes that an opaque widget or the root, and clearing inside it would
+    // punch holes in what the parent just drew.
+    void Draw(SDL_Renderer* renderer, bool force) {
+        const bool repaint = force || dirty;
+        dirty = false;
+        if (!visible) {
+            return;
+        }
+        if (repaint) {
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+            if (!force) {
+                SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+                SDL_RenderFillRect(renderer, &rect);
+            }
+            DrawSelf(renderer);
+            force = true;
+        }
+        for (auto& child : children) {
+            child->Draw(renderer, force);
+        }
+    }
+
+    bool NeedsDraw() const {
+        if (dirty) {
+            return true;
+        }
+        for (const auto& child : children) {
+            if (child->NeedsDraw()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Drops cached textures, e.g. after the renderer lost its targets.
+    virtual void Invalidate() {
+        dirty = true;
+        for (auto& child : children) {
+            child->Invalidate();
+        }
+    }
+
+protected:
+    virtual void DrawSelf(SDL_Renderer* renderer) = 0;
+    // True if DrawSelf() covers the whole rect with opaque pixels.
+    virtual bool Opaque() const { return false; }
+
+    SDL_Rect rect;
+    Widget* parent;
+    std::vector<std::unique_ptr<Widget>> children;
+    bool dirty;
+    bool visible;
+};
+
+class Panel : public Widget {
+public:
+    Panel(const SDL_Rect& r, SDL_Color c) : Widget(r), color(c) {}
+
+    void SetColor(SDL_Color c) {
+        color = c;
+        MarkDirty();
+    }
+
+protected:
+    void DrawSelf(SDL_Renderer* renderer) override {
+        SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        SDL_RenderFillRect(renderer, &rect);
+    }
+    bool Opaque() const override { return color.a == 255; }
+
+private:
+    SDL_Color color;
+};
+
+// Text is rasterized once and kept as a texture until SetText() changes it.
+class Label : public Widget {
+public:
+    Label(const SDL_Rect& r, TTF_Font* f, const std::string& t, SDL_Color c)
+        : Widget(r), font(f), text(t), color(c), texture(nullptr) {}
+    ~Label() override { Release(); }
+
+    void SetText(const std::string& t) {
+        if (t != text) {
+            text = t;
+            Release();
+            MarkDirty();
+        }
+    }
+
+    void Invalidate() override {
+        Release();
+        Widget::Invalidate();
+    }
+
+protected:
+    void DrawSelf(SDL_Renderer* renderer) override {
+        if (!texture && font) {
+            SDL_Surface* surface = TTF_RenderText_Solid(font, text.c_str(), color);
+            if (!surface) {
+                LOG_ERROR("Failed to render text surface: {}", TTF_GetError());
+                return;
+            }
+            texture = SDL_CreateTextureFromSurface(renderer, surface);
+            SDL_FreeSurface(surface);
+            if (!texture) {
+                LOG_ERROR("Failed to create texture from surface: {}", SDL_GetError());
+                return;
+            }
+        }
+        SDL_RenderCopy(renderer, texture, nullptr, &rect);
+    }
+
+private:
+    TTF_Font* font;
+    std::string text;
+    SDL_Color color;
+    SDL_Texture* texture;
+
+    void Release() {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+            texture = nullptr;
+        }
+    }
+};
+
+// A filled box with a label. It takes focus for keyboard navigation and
+// fires onActivate from Enter (when focused) or from its hotkey.
+class Button : public Widget {
+public:
+    Button(const SDL_Rect& r, SDL_Color bg, SDL_Keycode key, std::function<void()> activate)
+        : Widget(r), background(bg), hotkey(key), onActivate(std::move(activate)), focused(false) {}
+
+    Label* SetLabel(const SDL_Rect& r, TTF_Font* font, const std::string& text, SDL_Color color) {
+        return Add(new Label(r, font, text, color));
+    }
+
+    void SetFocused(bool f) {
+        if (f != focused) {
+            focused = f;
+            MarkDirty();
+        }
+    }
+    SDL_Keycode Hotkey() const { return hotkey; }
+    void Activate() {
+        if (onActivate) {
+            onActivate();
+        }
+    }
+
+protected:
+    void DrawSelf(SDL_Renderer* renderer) override {
+        SDL_SetRenderDrawColor(renderer, background.r, background.g, background.b, background.a);
+        SDL_RenderFillRect(renderer, &rect);
+        if (focused) {
+            // Inside our own rect so clearing it also clears the highlight.
+            SDL_SetRenderDrawColor(renderer, 255, 255, 0, 255);
+            for (int i = 0; i < 3; ++i) {
+                SDL_Rect outline = {rect.x + i, rect.y + i, rect.w - 2 * i, rect.h - 2 * i};
+                SDL_RenderDrawRect(renderer, &outline);
+            }
+        }
+    }
+    bool Opaque() const override { return background.a == 255; }
+
+private:
+    SDL_Color background;
+    SDL_Keycode hotkey;
+    std::function<void()> onActivate;
+    bool focused;
+};
+
+class UiScreen {
+public:
+    UiScreen(SDL_Renderer* r, int w, int h) : renderer(r), width(w), height(h), cache(nullptr), focus(-1) {
+        root.reset(new Container({0, 0, w, h}));
+    }
+    ~UiScreen() {
+        if (cache) {
+            SDL_DestroyTexture(cache);
+        }
+    }
+
+    Widget* Root() { return root.get(); }
+
+    // Buttons take part in focus order in the order they are registered.
+    Button* AddButton(Widget* parent, Button* button) {
+        parent->Add(button);
+        buttons.push_back(button);
+        if (focus < 0) {
+            SetFocus(0);
+        }
+        return button;
+    }
+
+    // What Esc does on this screen.
+    void SetCancel(std::function<void()> action) { onCancel = std::move(action); }
+
+    // Returns true if the key was used by the screen.
+    bool HandleKey(SDL_Keycode key) {
+        if (key == SDLK_ESCAPE && onCancel) {
+            onCancel();
+            return true;
+        }
+        for (Button* b : buttons) {
+            if (key != SDLK_UNKNOWN && b->Hotkey() == key) {
+                b->Activate();
+                return true;
+            }
+        }
+        if (buttons.empty()) {
+            return false;
+        }
+        int count = static_cast<int>(buttons.size());
+        switch (key) {
+            case SDLK_UP:
+                SetFocus((focus + count - 1) % count);
+                return true;
+            case SDLK_DOWN:
+            case SDLK_TAB:
+                SetFocus((focus + 1) % count);
+                return true;
+            case SDLK_RETURN:
+                if (focus >= 0) {
+                    buttons[focus]->Activate();
+                }
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // Call on SDL_RENDER_TARGETS_RESET / SDL_RENDER_DEVICE_RESET.
+    void Invalidate() {
+        if (cache) {
+            SDL_DestroyTexture(cache);
+            cache = nullptr;
+        }
+        root->Invalidate();
+    }
+
+    void Render() {
+        if (!cache) {
+            cache = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, width, height);
+            if (!cache) {
+                LOG_ERROR("Failed to create UI cache: {}", SDL_GetError());
+                return;
+            }
+            SDL_SetTextureBlendMode(cache, SDL_BLENDMODE_BLEND);
+            root->Invalidate();
+        }
+        if (root->NeedsDraw()) {
+            SDL_Texture* previous = SDL_GetRenderTarget(renderer);
+            SDL_SetRenderTarget(renderer, cache);
+            root->Draw(renderer, false);
+            SDL_SetRenderTarget(renderer, previous);
+            SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_NONE);
+        }
+        SDL_RenderCopy(renderer, cache, nullptr, nullptr);
+    }
+
+private:
+    // Transparent root that only groups widgets.
+    class Container : public Widget {
+    public:
+        explicit Container(const SDL_Rect& r) : Widget(r) {}
+
+    protected:
+        void DrawSelf(SDL_Renderer*) override {}
+    };
+
+    SDL_Renderer* renderer;
+    int width, height;
+    SDL_Texture* cache;
+    std::unique_ptr<Widget> root;
+    std::vector<Button*> buttons;
+    std::function<void()> onCancel;
+    int focus;
+
+    void SetFocus(int index) {
+        if (focus >= 0 && focus < static_cast<int>(buttons.size())) {
+            buttons[focus]->SetFocused(false);
+        }
+        focus = index;
+        buttons[focus]->SetFocused(true);
+    }
+};
+
+#endif
@@ -0,0 +1,18 @@
+#ifndef VOICE_MIXER_H
+#define VOICE_MIXER_H
+
+// A mixer that plays sounds as voices with a gain and a pan that can be
+// changed while they play. SoftMixer implements it with its own voices and
+// SfxSystem with SDL_mixer channels; PositionalAudio drives either.
+class VoiceMixer {
+public:
+    virtual ~VoiceMixer() {}
+
+    // Any thread. gain is 0..1 and pan -1 (left) .. 1 (right). Returns a
+    // voice id for SetVoice()/Stop(), or 0 if the request was dropped.
+    virtual int Play(int sound, float gain, float pan, bool loop = false) = 0;
+    virtual bool SetVoice(int id, float gain, float pan) = 0;
+    virtual bool Stop(int id) = 0;
+};
+
+#endif